@@ -1,8 +1,10 @@
 #include "devices/timer.h"
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stdio.h>
+#include "intrinsic.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/synch.h"
@@ -24,13 +26,75 @@ static int64_t ticks;
    가장 이른 알람시간 ≤ 현재 ticks 이면, 깨울 스레드가 없다는 의미이다. */
 int64_t MIN_alarm_time = INT64_MAX;
 
-/* Number of loops per timer tick.
-   Initialized by timer_calibrate(). */
-static unsigned loops_per_tick;
+/* 8254 input frequency. */
+#define PIT_HZ 1193180
+
+/* PIT input frequency divided by TIMER_FREQ, rounded to nearest:
+   the PIT count for one timer tick. */
+#define PIT_TICK_COUNT ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Longest and shortest PIT periods we program.  The longest is
+   what the 16-bit counter holds (about 55 ms); the shortest (about
+   13 us) keeps a wakeup that is already due from turning into an
+   interrupt storm. */
+#define PIT_COUNT_MAX 0xffff
+#define PIT_COUNT_MIN 16
+
+#define NS_PER_SEC 1000000000LL
+#define NS_PER_TICK (NS_PER_SEC / TIMER_FREQ)
+
+/* Sub-tick sleeps shorter than this spin on the TSC: blocking and
+   taking an interrupt would cost about as much. */
+#define HRSLEEP_MIN_NS 20000
+
+/* Ticks over which timer_calibrate() counts TSC cycles. */
+#define CALIBRATE_TICKS (TIMER_FREQ / 10)
+
+/* PIT counts in the current period, and the counts that had
+   passed since the last tick boundary when it began.  A period
+   normally ends on the next tick boundary, but may be cut short
+   for a sub-tick wakeup or stretched over several ticks while the
+   CPU idles. */
+static unsigned pit_period;
+static unsigned pit_residue;
+
+/* True if pit_fold() found the current period already run out and
+   credited it, so that the IRQ 0 still pending for it must not be
+   credited again. */
+static bool pit_stale;
+
+/* Value of ticks when timer_interrupt() last did per-tick work.
+   Ticks credited outside the handler are caught up at the next
+   interrupt. */
+static int64_t ticks_handled;
+
+/* TSC frequency, 0 until timer_calibrate() measures it, and the
+   TSC reading and timer_ns() value at that point.  NS_MULT is
+   nanoseconds per cycle as a 32.32 fixed-point number. */
+static uint64_t tsc_hz;
+static uint64_t tsc_base;
+static int64_t ns_base;
+static uint64_t ns_mult;
+
+/* A thread in timer_hrsleep(). */
+struct hrsleeper {
+	struct list_elem elem;      /* Element in hrsleep_list. */
+	int64_t deadline;           /* Wake at this timer_ns(). */
+	struct semaphore sema;      /* Upped at the deadline. */
+};
+
+/* Threads in timer_hrsleep(), earliest deadline first. */
+static struct list hrsleep_list;
 
 static intr_handler_func timer_interrupt;
-static bool too_many_loops (unsigned loops);
-static void busy_wait (int64_t loops);
+static void pit_program (unsigned count);
+static unsigned pit_read (void);
+static bool pit_irq_pending (void);
+static void pit_advance (unsigned elapsed);
+static void pit_fold (void);
+static unsigned pit_next_period (int64_t until);
+static void hrsleep_wake (void);
+static void timer_hrsleep (int64_t ns);
 static void real_time_sleep (int64_t num, int32_t denom);
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
@@ -38,40 +102,42 @@ static void real_time_sleep (int64_t num, int32_t denom);
    corresponding interrupt. */
 void
 timer_init (void) {
-	/* 8254 input frequency divided by TIMER_FREQ, rounded to
-	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
-
-	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb (0x40, count & 0xff);
-	outb (0x40, count >> 8);
-
+	list_init (&hrsleep_list);
+	pit_program (PIT_TICK_COUNT);
 	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Measures the TSC frequency against the PIT, after which
+   timer_ns() counts TSC cycles instead of timer ticks. */
 void
 timer_calibrate (void) {
-	unsigned high_bit, test_bit;
+	enum intr_level old_level;
+	uint64_t start_tsc, end_tsc;
+	int64_t start;
 
 	ASSERT (intr_get_level () == INTR_ON);
 	printf ("Calibrating timer...  ");
 
-	/* Approximate loops_per_tick as the largest power-of-two
-	   still less than one timer tick. */
-	loops_per_tick = 1u << 10;
-	while (!too_many_loops (loops_per_tick << 1)) {
-		loops_per_tick <<= 1;
-		ASSERT (loops_per_tick != 0);
-	}
-
-	/* Refine the next 8 bits of loops_per_tick. */
-	high_bit = loops_per_tick;
-	for (test_bit = high_bit >> 1; test_bit != high_bit >> 10; test_bit >>= 1)
-		if (!too_many_loops (high_bit | test_bit))
-			loops_per_tick |= test_bit;
+	/* Count the cycles across CALIBRATE_TICKS whole ticks. */
+	start = ticks;
+	while (ticks == start)
+		barrier ();
+	start_tsc = rdtsc ();
+	start = ticks;
+	while (ticks - start < CALIBRATE_TICKS)
+		barrier ();
+	end_tsc = rdtsc ();
+
+	/* The last tick began at END_TSC, so line the TSC clock up with
+	   it; timer_ns() cannot have got past it yet. */
+	old_level = intr_disable ();
+	tsc_base = end_tsc;
+	ns_base = (start + CALIBRATE_TICKS) * NS_PER_TICK;
+	tsc_hz = (end_tsc - start_tsc) * TIMER_FREQ / CALIBRATE_TICKS;
+	ns_mult = ((uint64_t) NS_PER_SEC << 32) / tsc_hz;
+	intr_set_level (old_level);
 
-	printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+	printf ("%'"PRIu64" cycles/s.\n", tsc_hz);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -84,6 +150,17 @@ timer_ticks (void) {
 	return t;
 }
 
+/* Returns the nanoseconds since the OS booted.  Monotonic; counts
+   TSC cycles once timer_calibrate() has run, and whole timer ticks
+   before that. */
+int64_t
+timer_ns (void) {
+	if (tsc_hz == 0)
+		return timer_ticks () * NS_PER_TICK;
+	return ns_base
+		+ (int64_t) (((unsigned __int128) (rdtsc () - tsc_base) * ns_mult) >> 32);
+}
+
 /* Returns the number of timer ticks elapsed since THEN, which
    should be a value once returned by timer_ticks(). */
 int64_t
@@ -129,11 +206,59 @@ timer_print_stats (void) {
 	printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
 }
 
+/* Called by the idle thread, with interrupts off, just before it
+   halts.  Stretches the next timer interrupt out to tick NEXT, the
+   earliest pending wakeup, or as far as the PIT reaches if that
+   comes first, so that an idle CPU is not woken every tick. */
+void
+timer_idle_enter (int64_t next) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (next - ticks <= 1)
+		return;
+	pit_fold ();
+	pit_program (pit_next_period (next));
+}
+
+/* Called by the idle thread, with interrupts off, after it wakes.
+   If an interrupt other than the timer's woke it early, credits the
+   time that has passed and goes back to periodic ticks. */
+void
+timer_idle_exit (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (pit_period <= PIT_TICK_COUNT - pit_residue)
+		return;
+	pit_fold ();
+	pit_program (pit_next_period (ticks + 1));
+	if (MIN_alarm_time <= ticks)
+		thread_awake (ticks);
+	hrsleep_wake ();
+}
+
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED) {
-	ticks++;
-	thread_tick ();
+	int64_t prev = ticks_handled;
+	unsigned period;
+
+	if (pit_stale) {
+		/* pit_fold() credited this period and started another. */
+		pit_stale = false;
+	} else {
+		/* The period that just ended may have been cut short for a
+		   sub-tick wakeup or stretched over several idle ticks;
+		   only whole ticks count. */
+		pit_advance (pit_period);
+		period = pit_next_period (ticks + 1);
+		if (period != pit_period)
+			pit_program (period);
+	}
+	hrsleep_wake ();
+	if (ticks == prev)
+		return;
+	ticks_handled = ticks;
+	thread_tick (ticks - prev);
 
 	if (thread_mlfqs) {
 		mlfqs_increment();
@@ -141,7 +266,7 @@ timer_interrupt (struct intr_frame *args UNUSED) {
 			struct thread *t = thread_current();
 			mlfqs_priority(t);
 		}
-		if (timer_ticks() % 100 == 0) {
+		if (ticks / TIMER_FREQ != prev / TIMER_FREQ) {
 			mlfqs_load_avg();
 			mlfqs_recalc();
 		}
@@ -151,35 +276,153 @@ timer_interrupt (struct intr_frame *args UNUSED) {
 	}
 }
 
-/* Returns true if LOOPS iterations waits for more than one timer
-   tick, otherwise false. */
+/* Restarts PIT counter 0 so that it interrupts every COUNT PIT
+   cycles. */
+static void
+pit_program (unsigned count) {
+	ASSERT (count >= PIT_COUNT_MIN && count <= PIT_COUNT_MAX);
+
+	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
+	pit_period = count;
+}
+
+/* Returns the count remaining in PIT counter 0's current period. */
+static unsigned
+pit_read (void) {
+	uint8_t lo, hi;
+
+	outb (0x43, 0x00);    /* CW: latch counter 0. */
+	lo = inb (0x40);
+	hi = inb (0x40);
+	return lo | (hi << 8);
+}
+
+/* Returns true if IRQ 0 is raised but not yet delivered.  See
+   [8259A] "OCW3". */
 static bool
-too_many_loops (unsigned loops) {
-	/* Wait for a timer tick. */
-	int64_t start = ticks;
-	while (ticks == start)
-		barrier ();
+pit_irq_pending (void) {
+	outb (0x20, 0x0a);    /* OCW3: read the IRR on the next read. */
+	return (inb (0x20) & 1) != 0;
+}
 
-	/* Run LOOPS loops. */
-	start = ticks;
-	busy_wait (loops);
+/* Credits ELAPSED PIT cycles, turning each whole tick's worth into
+   a timer tick. */
+static void
+pit_advance (unsigned elapsed) {
+	pit_residue += elapsed;
+	ticks += pit_residue / PIT_TICK_COUNT;
+	pit_residue %= PIT_TICK_COUNT;
+}
 
-	/* If the tick count changed, we iterated too long. */
-	barrier ();
-	return start != ticks;
+/* Credits the part of the current PIT period that has passed, so
+   that the caller can start a new one.  Interrupts must be off. */
+static void
+pit_fold (void) {
+	unsigned remaining;
+	bool ended;
+
+	/* If the period ran out with its interrupt still pending, the
+	   counter has reloaded and is counting the same period again.
+	   Sample the IRR on both sides of the count so that the two
+	   agree. */
+	do {
+		ended = !pit_stale && pit_irq_pending ();
+		remaining = pit_read ();
+	} while (ended != (!pit_stale && pit_irq_pending ()));
+
+	if (remaining > pit_period)
+		remaining = pit_period;
+	if (ended) {
+		pit_advance (pit_period);
+		pit_stale = true;
+	}
+	pit_advance (pit_period - remaining);
 }
 
-/* Iterates through a simple loop LOOPS times, for implementing
-   brief delays.
+/* Returns the length, in PIT cycles, of a period that starts now
+   and ends at tick UNTIL or at the earliest sub-tick wakeup,
+   whichever comes first, within what the PIT can count. */
+static unsigned
+pit_next_period (int64_t until) {
+	int64_t count;
+
+	if (until - ticks > PIT_COUNT_MAX / PIT_TICK_COUNT + 1)
+		count = PIT_COUNT_MAX;
+	else
+		count = (until - ticks) * PIT_TICK_COUNT - pit_residue;
+
+	if (!list_empty (&hrsleep_list)) {
+		struct hrsleeper *s = list_entry (list_front (&hrsleep_list),
+				struct hrsleeper, elem);
+		int64_t ns = s->deadline - timer_ns ();
+
+		/* Round up so that the interrupt never comes early. */
+		if (ns < count * NS_PER_SEC / PIT_HZ)
+			count = ns * PIT_HZ / NS_PER_SEC + 1;
+	}
 
-   Marked NO_INLINE because code alignment can significantly
-   affect timings, so that if this function was inlined
-   differently in different places the results would be difficult
-   to predict. */
-static void NO_INLINE
-busy_wait (int64_t loops) {
-	while (loops-- > 0)
-		barrier ();
+	if (count < PIT_COUNT_MIN)
+		count = PIT_COUNT_MIN;
+	if (count > PIT_COUNT_MAX)
+		count = PIT_COUNT_MAX;
+	return count;
+}
+
+/* Wakes the threads in timer_hrsleep() whose deadline has come.
+   Interrupts must be off. */
+static void
+hrsleep_wake (void) {
+	int64_t now;
+	bool woke = false;
+
+	if (list_empty (&hrsleep_list))
+		return;
+	now = timer_ns ();
+	while (!list_empty (&hrsleep_list)) {
+		struct hrsleeper *s = list_entry (list_front (&hrsleep_list),
+				struct hrsleeper, elem);
+
+		if (s->deadline > now)
+			break;
+		list_pop_front (&hrsleep_list);
+		sema_up (&s->sema);
+		woke = true;
+	}
+
+	/* Let the sleeper run now rather than at the next tick. */
+	if (woke && intr_context ())
+		intr_yield_on_return ();
+}
+
+/* Returns true if hrsleeper A's deadline comes before B's. */
+static bool
+hrsleeper_less (const struct list_elem *a_, const struct list_elem *b_,
+		void *aux UNUSED) {
+	const struct hrsleeper *a = list_entry (a_, struct hrsleeper, elem);
+	const struct hrsleeper *b = list_entry (b_, struct hrsleeper, elem);
+
+	return a->deadline < b->deadline;
+}
+
+/* Blocks for NS nanoseconds, less than a tick, by cutting the
+   current PIT period short to end at the deadline. */
+static void
+timer_hrsleep (int64_t ns) {
+	struct hrsleeper s;
+	enum intr_level old_level;
+
+	s.deadline = timer_ns () + ns;
+	sema_init (&s.sema, 0);
+
+	old_level = intr_disable ();
+	list_insert_ordered (&hrsleep_list, &s.elem, hrsleeper_less, NULL);
+	pit_fold ();
+	pit_program (pit_next_period (ticks + 1));
+	intr_set_level (old_level);
+
+	sema_down (&s.sema);
 }
 
 /* Sleep for approximately NUM/DENOM seconds. */
@@ -200,10 +443,22 @@ real_time_sleep (int64_t num, int32_t denom) {
 		   processes. */
 		timer_sleep (ticks);
 	} else {
-		/* Otherwise, use a busy-wait loop for more accurate
-		   sub-tick timing.  We scale the numerator and denominator
-		   down by 1000 to avoid the possibility of overflow. */
+		/* Otherwise, for more accurate sub-tick timing, block until
+		   a PIT interrupt set for the deadline, or spin on the TSC
+		   if the wait is too short to be worth that.  We scale the
+		   numerator and denominator down by 1000 to avoid the
+		   possibility of overflow. */
+		int64_t ns;
+
 		ASSERT (denom % 1000 == 0);
-		busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
+		ns = num * (NS_PER_SEC / 1000) / (denom / 1000);
+		if (ns >= HRSLEEP_MIN_NS && tsc_hz != 0) {
+			timer_hrsleep (ns);
+		} else {
+			int64_t deadline = timer_ns () + ns;
+
+			while (timer_ns () < deadline)
+				asm volatile ("pause");
+		}
 	}
 }
@@ -136,6 +136,11 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	if (*name == '\0' || strlen (name) > NAME_MAX)
 		return false;
 
+	/* Hold the directory from the name check until the slot is
+	 * written, so that two creators cannot add the same name or
+	 * pick the same free slot. */
+	inode_dir_lock (dir->inode);
+
 	/* Check that NAME is not in use. */
 	if (lookup (dir, name, NULL, NULL))
 		goto done;
@@ -159,6 +164,7 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
 
 done:
+	inode_dir_unlock (dir->inode);
 	return success;
 }
 
@@ -175,6 +181,8 @@ dir_remove (struct dir *dir, const char *name) {
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
+	inode_dir_lock (dir->inode);
+
 	/* Find directory entry. */
 	if (!lookup (dir, name, &e, &ofs))
 		goto done;
@@ -194,6 +202,7 @@ dir_remove (struct dir *dir, const char *name) {
 	success = true;
 
 done:
+	inode_dir_unlock (dir->inode);
 	inode_close (inode);
 	return success;
 }
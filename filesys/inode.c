@@ -6,6 +6,7 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -33,6 +34,8 @@ struct inode {
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+	struct rwlock rw;                   /* Readers share, writers exclude. */
+	struct lock dir_lock;               /* Serializes directory entry changes. */
 	struct inode_disk data;             /* Inode content. */
 };
 
@@ -53,10 +56,15 @@ byte_to_sector (const struct inode *inode, off_t pos) {
  * returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Protects open_inodes and the open and deny-write counts of
+ * the inodes on it. */
+static struct lock open_inodes_lock;
+
 /* Initializes the inode module. */
 void
 inode_init (void) {
 	list_init (&open_inodes);
+	lock_init (&open_inodes_lock);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -104,36 +112,48 @@ inode_open (disk_sector_t sector) {
 	struct list_elem *e;
 	struct inode *inode;
 
+	lock_acquire (&open_inodes_lock);
+
 	/* Check whether this inode is already open. */
 	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
 			e = list_next (e)) {
 		inode = list_entry (e, struct inode, elem);
 		if (inode->sector == sector) {
-			inode_reopen (inode);
+			inode->open_cnt++;
+			lock_release (&open_inodes_lock);
 			return inode; 
 		}
 	}
 
 	/* Allocate memory. */
 	inode = malloc (sizeof *inode);
-	if (inode == NULL)
+	if (inode == NULL) {
+		lock_release (&open_inodes_lock);
 		return NULL;
+	}
 
-	/* Initialize. */
+	/* Initialize.  Read the disk inode before releasing the lock so
+	 * that a concurrent opener never sees it half filled. */
 	list_push_front (&open_inodes, &inode->elem);
 	inode->sector = sector;
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
+	rwlock_init (&inode->rw);
+	lock_init (&inode->dir_lock);
 	disk_read (filesys_disk, inode->sector, &inode->data);
+	lock_release (&open_inodes_lock);
 	return inode;
 }
 
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode) {
-	if (inode != NULL)
+	if (inode != NULL) {
+		lock_acquire (&open_inodes_lock);
 		inode->open_cnt++;
+		lock_release (&open_inodes_lock);
+	}
 	return inode;
 }
 
@@ -153,9 +173,11 @@ inode_close (struct inode *inode) {
 		return;
 
 	/* Release resources if this was the last opener. */
+	lock_acquire (&open_inodes_lock);
 	if (--inode->open_cnt == 0) {
 		/* Remove from inode list and release lock. */
 		list_remove (&inode->elem);
+		lock_release (&open_inodes_lock);
 
 		/* Deallocate blocks if removed. */
 		if (inode->removed) {
@@ -165,7 +187,8 @@ inode_close (struct inode *inode) {
 		}
 
 		free (inode); 
-	}
+	} else
+		lock_release (&open_inodes_lock);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -176,6 +199,19 @@ inode_remove (struct inode *inode) {
 	inode->removed = true;
 }
 
+/* Acquires the lock that serializes changes to the entries of
+ * directory INODE. */
+void
+inode_dir_lock (struct inode *inode) {
+	lock_acquire (&inode->dir_lock);
+}
+
+/* Releases the lock taken by inode_dir_lock(). */
+void
+inode_dir_unlock (struct inode *inode) {
+	lock_release (&inode->dir_lock);
+}
+
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
  * Returns the number of bytes actually read, which may be less
  * than SIZE if an error occurs or end of file is reached. */
@@ -184,7 +220,9 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 	uint8_t *buffer = buffer_;
 	off_t bytes_read = 0;
 	uint8_t *bounce = NULL;
+	struct rwlock_reader reader;
 
+	rwlock_acquire_read (&inode->rw, &reader);
 	while (size > 0) {
 		/* Disk sector to read, starting byte offset within sector. */
 		disk_sector_t sector_idx = byte_to_sector (inode, offset);
@@ -220,6 +258,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 		offset += chunk_size;
 		bytes_read += chunk_size;
 	}
+	rwlock_release_read (&inode->rw, &reader);
 	free (bounce);
 
 	return bytes_read;
@@ -237,8 +276,11 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 	off_t bytes_written = 0;
 	uint8_t *bounce = NULL;
 
-	if (inode->deny_write_cnt)
+	rwlock_acquire_write (&inode->rw);
+	if (inode->deny_write_cnt) {
+		rwlock_release_write (&inode->rw);
 		return 0;
+	}
 
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
@@ -282,6 +324,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		offset += chunk_size;
 		bytes_written += chunk_size;
 	}
+	rwlock_release_write (&inode->rw);
 	free (bounce);
 
 	return bytes_written;
@@ -292,8 +335,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 	void
 inode_deny_write (struct inode *inode) 
 {
+	lock_acquire (&open_inodes_lock);
 	inode->deny_write_cnt++;
 	ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+	lock_release (&open_inodes_lock);
 }
 
 /* Re-enables writes to INODE.
@@ -301,9 +346,11 @@ inode_deny_write (struct inode *inode)
  * inode_deny_write() on the inode, before closing the inode. */
 void
 inode_allow_write (struct inode *inode) {
+	lock_acquire (&open_inodes_lock);
 	ASSERT (inode->deny_write_cnt > 0);
 	ASSERT (inode->deny_write_cnt <= inode->open_cnt);
 	inode->deny_write_cnt--;
+	lock_release (&open_inodes_lock);
 }
 
 /* Returns the length, in bytes, of INODE's data. */
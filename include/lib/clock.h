@@ -0,0 +1,15 @@
+#ifndef __LIB_CLOCK_H
+#define __LIB_CLOCK_H
+
+#include <stdint.h>
+
+/* Clocks that clock_gettime() reads. */
+#define CLOCK_MONOTONIC 1           /* Time since boot; never goes back. */
+
+/* A time, as seconds plus nanoseconds. */
+struct timespec {
+	int64_t tv_sec;             /* Seconds. */
+	long tv_nsec;               /* Nanoseconds, 0 to 999,999,999. */
+};
+
+#endif /* lib/clock.h */
@@ -0,0 +1,64 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Priority heap.
+ *
+ * This is an intrusive pairing heap.  Like the list and hash
+ * table, it does no dynamic allocation: each structure that can
+ * be in a heap embeds a struct heap_elem member, and heap_entry
+ * converts a struct heap_elem back into the structure that
+ * contains it.
+ *
+ * heap_insert() and heap_top() take constant time, heap_pop()
+ * and heap_remove() take amortized O(log n) time.  Elements that
+ * compare equal come out in the order they were inserted.
+ *
+ * If the key of an element that is in a heap changes, call
+ * heap_update() on it to move it to its new place.  The heap
+ * never compares an element with itself while removing it, so
+ * the key may be changed before heap_update() is called. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem {
+	struct heap_elem *prev;     /* Parent if first child, else left sibling. */
+	struct heap_elem *next;     /* Right sibling. */
+	struct heap_elem *child;    /* Leftmost child. */
+	uint64_t seq;               /* Insertion order, breaks ties. */
+};
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+ * the structure that HEAP_ELEM is embedded inside.  Supply the
+ * name of the outer structure STRUCT and the member name MEMBER
+ * of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)           \
+	((STRUCT *) ((uint8_t *) &(HEAP_ELEM)->prev     \
+		- offsetof (STRUCT, MEMBER.prev)))
+
+/* Compares the value of two heap elements A and B, given
+ * auxiliary data AUX.  Returns true if A is less than B, or
+ * false if A is greater than or equal to B. */
+typedef bool heap_less_func (const struct heap_elem *a,
+		const struct heap_elem *b,
+		void *aux);
+
+/* Heap.  The top is its greatest element. */
+struct heap {
+	struct heap_elem *root;     /* Greatest element, or NULL. */
+	uint64_t seq;               /* Next insertion number. */
+	heap_less_func *less;       /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `less'. */
+};
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+bool heap_empty (const struct heap *);
+void heap_insert (struct heap *, struct heap_elem *);
+struct heap_elem *heap_top (const struct heap *);
+struct heap_elem *heap_pop (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+void heap_update (struct heap *, struct heap_elem *);
+
+#endif /* lib/kernel/heap.h */
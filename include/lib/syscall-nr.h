@@ -36,6 +36,18 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Memory management extensions. */
+	SYS_MADVISE,                /* Give advice about use of memory. */
+	SYS_MSYNC,                  /* Write back a memory mapping. */
+	SYS_MEMLIMIT,               /* Limit the resident set size. */
+	SYS_OOM_ADJUST,             /* Bias the OOM killer. */
+	SYS_SBRK,                   /* Move the program break. */
+	SYS_VMSTAT,                 /* Read page-fault statistics. */
+
+	/* Scheduling extensions. */
+	SYS_SCHED_DEADLINE,         /* Reserve real-time CPU bandwidth. */
+	SYS_CLOCK_GETTIME,          /* Read a high-resolution clock. */
 };
 
 #endif /* lib/syscall-nr.h */
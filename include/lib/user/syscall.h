@@ -4,6 +4,9 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <vmstat.h>
+#include <clock.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -12,6 +15,15 @@ typedef int pid_t;
 /* Map region identifier. */
 typedef int off_t;
 #define MAP_FAILED ((void *) NULL)
+#define MAP_POPULATE 0x2        /* OR into mmap's WRITABLE to prefault. */
+#define MAP_ANON_FD (-1)        /* mmap FD for zero-filled memory. */
+
+/* Advice values for madvise(). */
+#define MADV_NORMAL 0           /* No special treatment. */
+#define MADV_RANDOM 1           /* Expect random page references. */
+#define MADV_SEQUENTIAL 2       /* Expect sequential page references. */
+#define MADV_WILLNEED 3         /* Will need these pages soon. */
+#define MADV_DONTNEED 4         /* Don't need these pages anymore. */
 
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
@@ -41,6 +53,14 @@ int dup2(int oldfd, int newfd);
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
+int madvise (void *addr, size_t length, int advice);
+int msync (void *addr, size_t length);
+size_t memlimit (size_t pages);
+int oom_adjust (int adj);
+void *sbrk (intptr_t increment);
+int vmstat (struct vmstat *);
+int sched_deadline (unsigned runtime, unsigned deadline, unsigned period);
+int clock_gettime (int clock, struct timespec *ts);
 
 /* Project 4 only. */
 bool chdir (const char *dir);
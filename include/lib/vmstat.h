@@ -0,0 +1,26 @@
+#ifndef __LIB_VMSTAT_H
+#define __LIB_VMSTAT_H
+
+#include <stdint.h>
+
+/* Page-fault counters of one process. */
+struct vm_fault_counts {
+	unsigned minor;             /* Served without disk I/O. */
+	unsigned major_swap;        /* Read the page back from swap. */
+	unsigned major_file;        /* Read the page from a file. */
+	unsigned stack;             /* Grew the stack. */
+	unsigned evictions;         /* Frames taken from others to serve them. */
+};
+
+/* Number of buckets in the fault latency histogram. */
+#define VMSTAT_BUCKETS 40
+
+/* What the vmstat system call reports. */
+struct vmstat {
+	struct vm_fault_counts proc;        /* The calling process. */
+	/* Faults system-wide whose handling took [2**i, 2**(i+1)) TSC
+	   cycles; the last bucket also counts everything slower. */
+	uint64_t latency[VMSTAT_BUCKETS];
+};
+
+#endif /* lib/vmstat.h */
@@ -1,44 +1,101 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <debug.h>
 
+struct thread;
 
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
-	struct list waiters;        /* List of waiting threads. */
+	struct heap waiters;        /* Waiting threads, by priority. */
 };
 
 void sema_init (struct semaphore *, unsigned value);
 void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
+void sema_requeue (struct thread *);
 void sema_self_test (void);
 
 /* Lock. */
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
-	struct list_elem elem;
+	struct heap_elem elem;      /* Element in the holder's held_locks. */
+	int priority;               /* Highest priority donated through it. */
 };
 
 void lock_init (struct lock *);
-bool donations_priority_more(const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED);
+bool lock_priority_less (const struct heap_elem *, const struct heap_elem *,
+		void *aux);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
+/* Readers-writer lock.
+
+   Any number of readers or a single writer may hold it.  A writer
+   holds WLOCK for its whole critical section and readers take it
+   only to get in, so a thread waiting behind a writer donates its
+   priority to the writer through WLOCK, and once a writer is
+   waiting for the readers to drain no new reader can enter.
+
+   Each reader inside is recorded by a struct rwlock_reader on its
+   own stack.  Its HOLD sits in the reader's held_locks like a lock
+   it holds, so a writer waiting for the readers to drain donates
+   its priority to every one of them. */
+struct rwlock {
+	struct lock wlock;          /* Held by the writer. */
+	struct list readers;        /* Readers inside, as rwlock_readers. */
+	bool draining;              /* Writer waits for readers to leave. */
+	struct semaphore drained;   /* Upped by the last reader to leave. */
+};
+
+/* One reader's hold on a rwlock, from rwlock_acquire_read() to
+   rwlock_release_read(). */
+struct rwlock_reader {
+	struct list_elem elem;      /* List element in rwlock's readers. */
+	struct lock hold;           /* Donation target; HOLD.holder reads. */
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *, struct rwlock_reader *);
+void rwlock_release_read (struct rwlock *, struct rwlock_reader *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+void rwlock_donate (struct rwlock *, int priority);
+bool rwlock_held_for_write (const struct rwlock *);
+
+/* Adaptive mutex.
+
+   Cheaper than a lock for short critical sections: an uncontended
+   mutex_lock() or mutex_unlock() is a single compare-and-swap with
+   interrupts left on.  A contending thread spins for a while if
+   the owner is running on another CPU, and otherwise sleeps.
+   Mutexes do not donate priority, so hold them only briefly. */
+struct mutex {
+	uintptr_t owner;            /* Owner, ORed with MUTEX_WAITERS. */
+	struct semaphore sema;      /* Where contending threads sleep. */
+};
+
+void mutex_init (struct mutex *);
+void mutex_lock (struct mutex *);
+bool mutex_trylock (struct mutex *);
+void mutex_unlock (struct mutex *);
+bool mutex_held_by_current_thread (const struct mutex *);
+
 /* Condition variable. */
 struct condition {
-	struct list waiters;        /* List of waiting threads. */
+	struct heap waiters;        /* Waiting threads, by priority. */
 };
 
 void cond_init (struct condition *);
-bool sema_priority_more (const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED);
 void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
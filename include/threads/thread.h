@@ -4,8 +4,10 @@
 #include <debug.h>
 #include <list.h>
 #include <stdint.h>
+#include <vmstat.h>
 #include "threads/synch.h"
 #include "threads/interrupt.h"
+#include "userprog/fdtable.h"
 #ifdef VM
 #include "vm/vm.h"
 #endif
@@ -34,10 +36,6 @@ typedef int tid_t;
 #define RECENT_CPU_DEFAULT 0
 #define LOAD_AVG_DEFAULT 0
 
-/* system call */
-#define FDT_PAGES 3
-#define FDCOUNT_LIMIT FDT_PAGES *(1 << 9)
-
 /* A kernel thread or user process.
  *
  * Each thread structure is stored in its own 4 kB page.  The
@@ -103,6 +101,8 @@ struct thread {
 	int priority;                       /* Priority. */
 	
 
+	struct list_elem allelem;           /* List element for all threads list. */
+
 	/* Shared between thread.c and synch.c. */
 	struct list_elem elem;              /* List element. */
 
@@ -112,12 +112,32 @@ struct thread {
 	/* Priority donation */
 	int original_priority;				/* boost 이전의 priority */
 	struct lock *waiting_lock;			/* 이 스레드가 사용을 기다리고 있는 락 */
-	struct list donations;				
-	struct list_elem donations_elem;
+	struct rwlock *waiting_rwlock;		/* reader들이 빠지기를 기다리는 rwlock */
+	struct heap held_locks;				/* 쥐고 있는 lock들, 최고 대기자 priority 순 */
+
+	/* 대기 중인 semaphore / condition. priority가 바뀌면 sema_requeue()로 재배치 */
+	struct semaphore *waiting_sema;		/* sema_down()으로 기다리는 semaphore */
+	struct heap_elem sema_elem;			/* waiting_sema->waiters 안의 원소 */
+	struct condition *waiting_cond;		/* cond_wait()으로 기다리는 condition */
+	struct heap_elem *cond_elem;		/* waiting_cond->waiters 안의 원소 */
 
 	/* Advanced Scheduler */
 	int nice;
 	int recent_cpu;
+	int64_t cpu_epoch;					/* recent_cpu가 마지막으로 decay된 시점(초) */
+
+	/* Completely fair scheduler */
+	uint64_t vruntime;					/* nice로 가중한 누적 실행 시간 */
+	struct heap_elem cfs_elem;			/* cfs_queue 안의 원소 */
+
+	/* Earliest deadline first. dl_runtime이 0이면 실시간 스레드가 아니다. */
+	int64_t dl_runtime;					/* 주기마다 받는 실행 예산(틱) */
+	int64_t dl_deadline;				/* 주기 시작부터 마감까지(틱) */
+	int64_t dl_period;					/* 주기(틱) */
+	int64_t dl_abs_deadline;			/* 현재 주기의 절대 마감 시각 */
+	int64_t dl_budget;					/* 이번 주기에 남은 예산 */
+	bool dl_throttled;					/* 예산을 다 써서 다음 주기를 기다리는 중 */
+	struct heap_elem dl_elem;			/* dl_queue 안의 원소 */
 	
 	/* process */
 	struct list child_list;
@@ -135,6 +155,24 @@ struct thread {
 #ifdef VM
 	/* Table for whole virtual memory owned by thread. */
 	struct supplemental_page_table spt;
+	size_t rss;                         /* Frames currently mapped. */
+	size_t rss_limit;                   /* Most frames allowed, 0 if none. */
+	size_t wss;                         /* Estimated working set, in pages. */
+	int wss_sample;                     /* Pages seen accessed this period. */
+	unsigned pf_cnt;                    /* Page faults handled. */
+	unsigned pf_last;                   /* pf_cnt at the last sample. */
+	unsigned pf_rate;                   /* Page faults in the last period. */
+	unsigned swap_cnt;                  /* Pages moved to or from disk. */
+	bool vm_suspended;                  /* Held back by load control. */
+	struct list_elem suspend_elem;      /* Element in suspended list. */
+	size_t swap_pages;                  /* Pages held in swap. */
+	int oom_adj;                        /* OOM score adjustment. */
+	bool oom_killed;                    /* Chosen by the OOM killer. */
+	void *heap_start;                   /* Start of the sbrk() heap. */
+	void *heap_brk;                     /* Current program break. */
+	void *mmap_hint;                    /* Next anonymous mmap ends here. */
+	void *stack_bottom;                 /* Lowest mapped stack page. */
+	struct vm_fault_counts faults;      /* Page faults by kind. */
 #endif
 	uintptr_t user_rsp;
 
@@ -144,8 +182,7 @@ struct thread {
 
 
 	/* filesys */
-	struct file **fd_table;
-	int fd_idx;
+	struct fd_table fds;                /* Open files. */
 	struct file *running;
 };
 
@@ -154,10 +191,14 @@ struct thread {
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler.
+   Controlled by kernel command-line option "-cfs". */
+extern bool thread_cfs;
+
 void thread_init (void);
 void thread_start (void);
 
-void thread_tick (void);
+void thread_tick (int64_t elapsed);
 void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
@@ -178,12 +219,17 @@ const char *thread_name (void);
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
 
+/* Performs some operation on thread t, given auxiliary data AUX. */
+typedef void thread_action_func (struct thread *t, void *aux);
+void thread_foreach (thread_action_func *, void *);
+
 int thread_get_priority (void);
 void thread_set_priority (int);
+bool thread_set_deadline (int64_t runtime, int64_t deadline, int64_t period);
 
 void refresh_priority (void);
 void donate_priority (void);
-void remove_with_lock (struct lock *lock);
+void donate_lock_priority (struct lock *, int priority);
 
 /* MLFQS */
 int thread_get_nice (void);
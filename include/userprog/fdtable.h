@@ -0,0 +1,43 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct file;
+
+/* File descriptors below FD_INLINE live in the thread itself.  Higher
+ * ones live in chunks of FD_CHUNK entries, reached through a directory
+ * of FD_CHUNKS pointers.  The directory and each chunk are allocated
+ * only when a descriptor first needs them. */
+#define FD_INLINE 8
+#define FD_CHUNK 64
+#define FD_CHUNKS 24
+#define FDCOUNT_LIMIT (FD_INLINE + FD_CHUNK * FD_CHUNKS)
+
+/* Slots 0 and 1 hold these instead of files. */
+#define FD_STDIN ((struct file *)1)
+#define FD_STDOUT ((struct file *)2)
+
+/* One chunk of the second level. */
+struct fd_chunk {
+    uint64_t used;                 // bit i set: files[i] is in use.
+    struct file *files[FD_CHUNK];
+};
+
+/* A process's file descriptor table. */
+struct fd_table {
+    struct file *files[FD_INLINE]; // descriptors 0 to FD_INLINE - 1.
+    uint8_t used;                  // bit i set: files[i] is in use.
+    uint32_t full;                 // bit i set: chunk i has no free slot.
+    struct fd_chunk **chunks;      // FD_CHUNKS entries, or NULL.
+};
+
+void fd_table_init(struct fd_table *fdt);
+int fd_table_add(struct fd_table *fdt, struct file *file);
+struct file *fd_table_get(struct fd_table *fdt, int fd);
+struct file *fd_table_remove(struct fd_table *fdt, int fd);
+bool fd_table_copy(struct fd_table *dst, struct fd_table *src);
+void fd_table_destroy(struct fd_table *fdt);
+
+#endif /* userprog/fdtable.h */
@@ -8,14 +8,29 @@
 #define DISK_SECTOR_SIZE 512
 #define BITMAP_ERROR SIZE_MAX
 struct page;
+struct supplemental_page_table;
 enum vm_type;
 
 struct anon_page {
-    int swap_sector; //섹터번호. -1이면, 메모리에있고 그외는 디스크(섹터)에 있음을 의미.
+    int swap_sector; //swap slot 번호. -1이면, 메모리에있고 그외는 swap 장치에 있음을 의미.
+    void *map_start; // 익명 mmap 페이지라면 그 매핑의 시작 주소, 아니면 NULL.
 };
-struct bitmap *swap_table;
-int swap_size;
+
+/* Type marker of pages that belong to an anonymous mmap.  Their aux is
+ * the start address of the mapping. */
+#define VM_ANON_MAP VM_MARKER_1
+
+/* Most swap devices that can be registered with -swap. */
+#define SWAP_DEV_MAX 4
+
+void vm_swap_register (int chan_no, int dev_no, int prio);
+void vm_swap_print_stats (void);
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+void anon_discard (struct page *page, struct thread *owner);
+void anon_release_swap (struct supplemental_page_table *spt,
+                        struct thread *owner);
+void *do_anon_mmap (void *addr, size_t length, int writable);
+void do_anon_munmap (void *addr);
 
 #endif
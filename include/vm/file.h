@@ -1,13 +1,30 @@
 #ifndef VM_FILE_H
 #define VM_FILE_H
+#include "devices/timer.h"
 #include "filesys/file.h"
 #include "vm/vm.h"
 
+#include <list.h>
+
 struct page;
+struct thread;
+struct lazy_load_info;
 enum vm_type;
 
+/* Ticks between two runs of the mmap write-back thread. */
+#define FLUSH_INTERVAL TIMER_FREQ
+
+/* Flag OR'd into do_mmap()'s WRITABLE to load the mapping up front.
+ * Must match MAP_POPULATE in lib/user/syscall.h. */
+#define MAP_POPULATE 0x2
+
 struct file_page {
-	
+	struct lazy_load_info *info;  /* File, offset and length backing the page. */
+	struct thread *owner;         /* Process whose page table maps the page. */
+	struct list_elem mmap_elem;   /* Element in the write-back list. */
+	struct list_elem flush_elem;  /* Element in a flush pass's batch. */
+	bool writing;                 /* Write-back in flight; frame stays put. */
+	bool listed;                  /* On the write-back list. */
 };
 
 void vm_file_init (void);
@@ -15,4 +32,7 @@ bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
 void do_munmap (void *va);
+int do_msync (void *addr, size_t length);
+void vm_file_flush (struct thread *owner);
+void vm_file_detach (struct thread *owner);
 #endif
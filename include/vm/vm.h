@@ -5,7 +5,7 @@
 #include "include/lib/kernel/hash.h"
 #include "include/threads/vaddr.h"
 #include "threads/palloc.h"
-struct list frame_table;
+#include "threads/synch.h"
 struct lock kill_lock;
 
 
@@ -30,6 +30,34 @@ enum vm_type {
     VM_MARKER_END = (1 << 31),
 };
 
+/* Access-pattern advice given through madvise().
+ * Values must match the MADV_* constants in lib/user/syscall.h. */
+enum vm_advice {
+    MADV_NORMAL = 0,     /* No special treatment. */
+    MADV_RANDOM = 1,     /* No read-ahead. */
+    MADV_SEQUENTIAL = 2, /* Aggressive read-ahead, drop pages behind. */
+    MADV_WILLNEED = 3,   /* Prefetch the range now. */
+    MADV_DONTNEED = 4,   /* Free the range now. */
+};
+
+/* Number of pages faulted in ahead of a MADV_SEQUENTIAL fault. */
+#define VM_READAHEAD_PAGES 8
+
+/* Ticks between two working-set samples. */
+#define WSS_INTERVAL (TIMER_FREQ / 4)
+
+/* Default for -thrash: evictions per WSS_INTERVAL taken as thrashing. */
+#define THRASH_DEFAULT 128
+
+/* Range of the per-process OOM score adjustment.  OOM_ADJ_MIN exempts
+ * a process from the OOM killer. */
+#define OOM_ADJ_MIN -1000
+#define OOM_ADJ_MAX 1000
+/* Failed evictions before the OOM killer is invoked. */
+#define OOM_EVICT_TRIES 8
+/* Exit status of a process killed for lack of memory. */
+#define OOM_EXIT_STATUS -9
+
 #include "vm/anon.h"
 #include "vm/file.h"
 #include "vm/uninit.h"
@@ -54,6 +82,7 @@ struct page {
     /* Your implementation */
     struct hash_elem hash_elem;  // for use spt hash-table.
     bool writable;               // to check page is writable.
+    enum vm_advice advice;       // access pattern hint from madvise().
 
     //bool is_stack;  // to check is it stack page.
     /* Per-type data are binded into the union.
@@ -68,11 +97,16 @@ struct page {
     };
 };
 
-/* The representation of "frame" */
+/* The representation of "frame".
+ * One entry per page of the user pool, allocated once by vm_init();
+ * an entry is free while its owner is NULL. */
 struct frame {
     void *kva;
     struct page *page;
-    struct list_elem frame_elem;
+    struct thread *owner;  // process whose page table maps this frame.
+    uint16_t pin_cnt;      // pinned by vm_pin_range(); not a victim.
+    uint8_t age;           // accessed bits of recent samples, newest high.
+    bool busy;             // being loaded or evicted; not a victim.
 };
 
 /* The function table for page operations.
@@ -93,11 +127,27 @@ struct page_operations {
 
 #define ONE_MB (1 << 20) // 1MB
 
+/* The stack may grow down to STACK_LIMIT.  The page below it is kept
+ * unmapped as a guard, so that overflowing the stack faults instead of
+ * running into the heap or an anonymous mapping. */
+#define STACK_LIMIT (USER_STACK - ONE_MB)
+#define STACK_GUARD (STACK_LIMIT - PGSIZE)
+
+/* True if [ADDR, ADDR + LENGTH) overlaps the stack area or its guard
+ * page, which mappings must leave alone. */
+#define vm_overlaps_stack(addr, length)              \
+    ((void *)(addr) < (void *)USER_STACK &&          \
+     (void *)(addr) + (length) > (void *)STACK_GUARD)
+
 /* Representation of current process's memory space.
  * We don't want to force you to obey any specific design for this struct.
  * All designs up to you for this. */
 struct supplemental_page_table {
     struct hash hash_table;
+    /* Serializes changes to which pages of this table are resident:
+     * the owner holds it while handling a fault or tearing pages down,
+     * and an evicting thread must take it before stealing a frame. */
+    struct lock lock;
 };
 
 #include "threads/thread.h"
@@ -119,7 +169,23 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage,
                                     bool writable, vm_initializer *init,
                                     void *aux);
 void vm_dealloc_page(struct page *page);
+void vm_free_frame(struct frame *frame);
+bool vm_try_busy_frame(struct frame *frame);
+void vm_unbusy_frame(struct frame *frame);
 bool vm_claim_page(void *va);
 enum vm_type page_get_type(struct page *page);
+int vm_madvise(void *addr, size_t length, enum vm_advice advice);
+void vm_print_stats(void);
+void *vm_sbrk(intptr_t increment);
+bool vm_get_stats(struct vmstat *st);
+
+/* Extra stack pages to map below a stack fault (-stack-pregrow). */
+extern unsigned vm_stack_pregrow;
+
+/* Eviction rate that triggers load control, 0 to disable (-thrash). */
+extern unsigned vm_thrash_threshold;
+bool vm_populate(void *addr, size_t length);
+bool vm_pin_range(const void *addr, size_t length, bool write);
+void vm_unpin_range(const void *addr, size_t length);
 
 #endif /* VM_VM_H */
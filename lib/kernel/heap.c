@@ -0,0 +1,160 @@
+/* Priority heap.
+
+   See heap.h for basic information. */
+
+#include "heap.h"
+#include "../debug.h"
+
+/* Returns true if element A should be above element B in H:
+   A is greater, or they are equal and A was inserted first. */
+static inline bool
+above (const struct heap *h, const struct heap_elem *a,
+		const struct heap_elem *b) {
+	if (h->less (b, a, h->aux))
+		return true;
+	if (h->less (a, b, h->aux))
+		return false;
+	return a->seq < b->seq;
+}
+
+/* Links the trees rooted at A and B, either of which may be
+   null, and returns the root of the result.  A and B must not
+   have siblings. */
+static struct heap_elem *
+meld (const struct heap *h, struct heap_elem *a, struct heap_elem *b) {
+	struct heap_elem *t;
+
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+	if (above (h, b, a)) {
+		t = a;
+		a = b;
+		b = t;
+	}
+
+	/* B becomes the leftmost child of A. */
+	b->prev = a;
+	b->next = a->child;
+	if (a->child != NULL)
+		a->child->prev = b;
+	a->child = b;
+	return a;
+}
+
+/* Combines the sibling list starting at FIRST into one tree and
+   returns its root.  Siblings are melded in pairs from left to
+   right, then the pairs are melded from right to left; this is
+   what gives the pairing heap its amortized bounds. */
+static struct heap_elem *
+merge_pairs (const struct heap *h, struct heap_elem *first) {
+	struct heap_elem *pairs = NULL;
+	struct heap_elem *root = NULL;
+
+	while (first != NULL) {
+		struct heap_elem *a = first;
+		struct heap_elem *b = a->next;
+
+		first = b != NULL ? b->next : NULL;
+		a->prev = a->next = NULL;
+		if (b != NULL)
+			b->prev = b->next = NULL;
+
+		/* Stack the pair on PAIRS through its `next' member. */
+		a = meld (h, a, b);
+		a->next = pairs;
+		pairs = a;
+	}
+
+	while (pairs != NULL) {
+		struct heap_elem *next = pairs->next;
+
+		pairs->next = NULL;
+		root = meld (h, root, pairs);
+		pairs = next;
+	}
+	return root;
+}
+
+/* Initializes H as an empty heap ordered by LESS, given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux) {
+	ASSERT (h != NULL);
+	ASSERT (less != NULL);
+
+	h->root = NULL;
+	h->seq = 0;
+	h->less = less;
+	h->aux = aux;
+}
+
+/* Returns true if H is empty, false otherwise. */
+bool
+heap_empty (const struct heap *h) {
+	return h->root == NULL;
+}
+
+/* Inserts E into H. */
+void
+heap_insert (struct heap *h, struct heap_elem *e) {
+	ASSERT (h != NULL);
+	ASSERT (e != NULL);
+
+	e->prev = e->next = e->child = NULL;
+	e->seq = h->seq++;
+	h->root = meld (h, h->root, e);
+}
+
+/* Returns the greatest element in H.  Undefined behavior if H is
+   empty. */
+struct heap_elem *
+heap_top (const struct heap *h) {
+	ASSERT (!heap_empty (h));
+	return h->root;
+}
+
+/* Removes the greatest element from H and returns it.
+   Undefined behavior if H is empty. */
+struct heap_elem *
+heap_pop (struct heap *h) {
+	struct heap_elem *top = heap_top (h);
+
+	heap_remove (h, top);
+	return top;
+}
+
+/* Removes E, which must be in H, from H. */
+void
+heap_remove (struct heap *h, struct heap_elem *e) {
+	struct heap_elem *sub;
+
+	ASSERT (h != NULL);
+	ASSERT (e != NULL);
+
+	if (e == h->root) {
+		h->root = merge_pairs (h, e->child);
+	} else {
+		/* Cut E's subtree out of its sibling list. */
+		if (e->prev->child == e)
+			e->prev->child = e->next;
+		else
+			e->prev->next = e->next;
+		if (e->next != NULL)
+			e->next->prev = e->prev;
+
+		sub = merge_pairs (h, e->child);
+		h->root = meld (h, h->root, sub);
+	}
+	e->prev = e->next = e->child = NULL;
+}
+
+/* Moves E, which must be in H, to its place in H after its key
+   changed.  E keeps its place among elements that compare equal
+   to it. */
+void
+heap_update (struct heap *h, struct heap_elem *e) {
+	heap_remove (h, e);
+	h->root = meld (h, h->root, e);
+}
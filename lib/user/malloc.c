@@ -0,0 +1,258 @@
+#include <malloc.h>
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+
+/* A user-space malloc().
+
+   This follows the kernel's allocator in threads/malloc.c.  Each
+   request is rounded up to a power of 2 and served from the free
+   list of the descriptor for that size class.  When the free list
+   is empty, a new page-sized "arena" is carved out of the heap
+   with sbrk() and split into blocks of that size.
+
+   User processes have a single thread, so the free lists need no
+   locking: the common malloc() and free() are a list push or pop.
+   Freed small blocks stay on their free list for reuse rather than
+   going back to the kernel, since the heap can only shrink from
+   its top.
+
+   Blocks too big for an arena get their own anonymous mapping
+   from mmap(), with the page count in the arena header, and are
+   returned to the kernel by free(). */
+
+#define PGSIZE 4096
+
+/* Free block. */
+struct block {
+	struct block *next;         /* Next free block of this size. */
+};
+
+/* Descriptor. */
+struct desc {
+	size_t block_size;          /* Size of each element in bytes. */
+	size_t blocks_per_arena;    /* Number of blocks in an arena. */
+	struct block *free_list;    /* Free blocks. */
+};
+
+/* Magic number for detecting arena corruption. */
+#define ARENA_MAGIC 0x6d3c1a5b
+
+/* Arena. */
+struct arena {
+	unsigned magic;             /* Always set to ARENA_MAGIC. */
+	struct desc *desc;          /* Owning descriptor, null for big block. */
+	size_t page_cnt;            /* Pages in a big block. */
+};
+
+/* Our set of descriptors. */
+static struct desc descs[10];   /* Descriptors. */
+static size_t desc_cnt;         /* Number of descriptors. */
+
+static struct arena *block_to_arena (struct block *);
+static bool new_arena (struct desc *);
+
+/* Initializes the descriptors. */
+static void
+malloc_init (void) {
+	size_t block_size;
+
+	for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2) {
+		struct desc *d = &descs[desc_cnt++];
+		ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
+		d->block_size = block_size;
+		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+		d->free_list = NULL;
+	}
+}
+
+/* Obtains and returns a new block of at least SIZE bytes.
+   Returns a null pointer if memory is not available. */
+void *
+malloc (size_t size) {
+	struct desc *d;
+	struct block *b;
+
+	/* A null pointer satisfies a request for 0 bytes. */
+	if (size == 0)
+		return NULL;
+
+	if (desc_cnt == 0)
+		malloc_init ();
+
+	/* Find the smallest descriptor that satisfies a SIZE-byte
+	   request. */
+	for (d = descs; d < descs + desc_cnt; d++)
+		if (d->block_size >= size)
+			break;
+	if (d == descs + desc_cnt) {
+		/* SIZE is too big for any descriptor.
+		   Map enough pages to hold SIZE plus an arena. */
+		size_t page_cnt = DIV_ROUND_UP (size + sizeof (struct arena), PGSIZE);
+		struct arena *a;
+
+		if (page_cnt == 0)
+			return NULL;
+		a = mmap (NULL, page_cnt * PGSIZE, true, MAP_ANON_FD, 0);
+		if (a == MAP_FAILED)
+			return NULL;
+
+		/* Initialize the arena to indicate a big block of PAGE_CNT
+		   pages, and return it. */
+		a->magic = ARENA_MAGIC;
+		a->desc = NULL;
+		a->page_cnt = page_cnt;
+		return a + 1;
+	}
+
+	/* If the free list is empty, create a new arena. */
+	if (d->free_list == NULL && !new_arena (d))
+		return NULL;
+
+	/* Get a block from free list and return it. */
+	b = d->free_list;
+	d->free_list = b->next;
+	return b;
+}
+
+/* Allocates and return A times B bytes initialized to zeroes.
+   Returns a null pointer if memory is not available. */
+void *
+calloc (size_t a, size_t b) {
+	void *p;
+	size_t size;
+
+	/* Calculate block size and make sure it fits in size_t. */
+	size = a * b;
+	if (size < a || size < b)
+		return NULL;
+
+	/* Allocate and zero memory. */
+	p = malloc (size);
+	if (p != NULL)
+		memset (p, 0, size);
+
+	return p;
+}
+
+/* Returns the number of bytes allocated for BLOCK. */
+static size_t
+block_size (void *block) {
+	struct block *b = block;
+	struct arena *a = block_to_arena (b);
+	struct desc *d = a->desc;
+
+	return d != NULL ? d->block_size : PGSIZE * a->page_cnt - sizeof *a;
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly moving
+   it in the process.
+   If successful, returns the new block; on failure, returns a
+   null pointer.
+   A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
+   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
+void *
+realloc (void *old_block, size_t new_size) {
+	if (new_size == 0) {
+		free (old_block);
+		return NULL;
+	} else {
+		void *new_block;
+		size_t old_size;
+
+		if (old_block == NULL)
+			return malloc (new_size);
+
+		/* The block already has room: nothing to do. */
+		old_size = block_size (old_block);
+		if (new_size <= old_size)
+			return old_block;
+
+		new_block = malloc (new_size);
+		if (new_block != NULL) {
+			memcpy (new_block, old_block, old_size);
+			free (old_block);
+		}
+		return new_block;
+	}
+}
+
+/* Frees block P, which must have been previously allocated with
+   malloc(), calloc(), or realloc(). */
+void
+free (void *p) {
+	struct block *b = p;
+	struct arena *a;
+	struct desc *d;
+
+	if (b == NULL)
+		return;
+
+	a = block_to_arena (b);
+	d = a->desc;
+	if (d == NULL) {
+		/* It's a big block.  Unmap its pages. */
+		munmap (a);
+		return;
+	}
+
+#ifndef NDEBUG
+	/* Clear the block to help detect use-after-free bugs. */
+	memset (b, 0xcc, d->block_size);
+#endif
+
+	/* Add block to free list. */
+	b->next = d->free_list;
+	d->free_list = b;
+}
+
+/* Extends the heap by one page and divides it into blocks for
+   descriptor D.  Returns false if the heap cannot grow. */
+static bool
+new_arena (struct desc *d) {
+	struct arena *a;
+	uintptr_t brk;
+	size_t pad, i;
+
+	/* Arenas must start on a page boundary, and the program may
+	   have moved the break by itself. */
+	brk = (uintptr_t) sbrk (0);
+	pad = ROUND_UP (brk, PGSIZE) - brk;
+	a = sbrk (pad + PGSIZE);
+	if (a == (void *) -1)
+		return false;
+	a = (struct arena *) ((uint8_t *) a + pad);
+
+	a->magic = ARENA_MAGIC;
+	a->desc = d;
+	a->page_cnt = 0;
+
+	/* Push the blocks so that they come off the list in address
+	   order. */
+	for (i = d->blocks_per_arena; i-- > 0; ) {
+		struct block *b = (struct block *) ((uint8_t *) (a + 1)
+		                                    + i * d->block_size);
+		b->next = d->free_list;
+		d->free_list = b;
+	}
+	return true;
+}
+
+/* Returns the arena that block B is inside. */
+static struct arena *
+block_to_arena (struct block *b) {
+	struct arena *a = (struct arena *) ((uintptr_t) b & ~(uintptr_t) (PGSIZE - 1));
+
+	/* Check that the arena is valid. */
+	ASSERT (a != NULL);
+	ASSERT (a->magic == ARENA_MAGIC);
+
+	/* Check that the block is properly aligned for the arena. */
+	ASSERT (a->desc == NULL
+	        || ((uintptr_t) b - (uintptr_t) (a + 1)) % a->desc->block_size == 0);
+	ASSERT (a->desc != NULL || (uintptr_t) b - (uintptr_t) a == sizeof *a);
+
+	return a;
+}
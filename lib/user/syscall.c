@@ -155,6 +155,46 @@ munmap (void *addr) {
 	syscall1 (SYS_MUNMAP, addr);
 }
 
+int
+madvise (void *addr, size_t length, int advice) {
+	return syscall3 (SYS_MADVISE, addr, length, advice);
+}
+
+int
+msync (void *addr, size_t length) {
+	return syscall2 (SYS_MSYNC, addr, length);
+}
+
+size_t
+memlimit (size_t pages) {
+	return syscall1 (SYS_MEMLIMIT, pages);
+}
+
+int
+oom_adjust (int adj) {
+	return syscall1 (SYS_OOM_ADJUST, adj);
+}
+
+void *
+sbrk (intptr_t increment) {
+	return (void *) syscall1 (SYS_SBRK, increment);
+}
+
+int
+vmstat (struct vmstat *st) {
+	return syscall1 (SYS_VMSTAT, st);
+}
+
+int
+sched_deadline (unsigned runtime, unsigned deadline, unsigned period) {
+	return syscall3 (SYS_SCHED_DEADLINE, runtime, deadline, period);
+}
+
+int
+clock_gettime (int clock, struct timespec *ts) {
+	return syscall2 (SYS_CLOCK_GETTIME, clock, ts);
+}
+
 bool
 chdir (const char *dir) {
 	return syscall1 (SYS_CHDIR, dir);
@@ -0,0 +1,37 @@
+/* Reads the monotonic clock with clock_gettime() and checks that
+   its readings are well formed, never go back, and resolve time
+   more finely than a timer tick. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  struct timespec a, b;
+  int64_t ns;
+  int i;
+
+  CHECK (clock_gettime (CLOCK_MONOTONIC + 1, &a) == -1,
+         "unknown clock rejected");
+  CHECK (clock_gettime (CLOCK_MONOTONIC, &a) == 0, "read monotonic clock");
+  if (a.tv_nsec < 0 || a.tv_nsec >= 1000000000)
+    fail ("tv_nsec out of range: %ld", a.tv_nsec);
+
+  /* Readings taken back to back may be equal but never decrease,
+     and some must differ by less than a 10 ms tick. */
+  for (i = 0; i < 1000; i++)
+    {
+      clock_gettime (CLOCK_MONOTONIC, &b);
+      ns = (b.tv_sec - a.tv_sec) * 1000000000 + (b.tv_nsec - a.tv_nsec);
+      if (ns < 0)
+        fail ("clock went back by %lld ns", -(long long) ns);
+      if (ns > 0 && ns < 10000000)
+        break;
+      a = b;
+    }
+  if (i == 1000)
+    fail ("no reading finer than a tick");
+  msg ("clock resolves time within a tick");
+}
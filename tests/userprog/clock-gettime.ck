@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(clock-gettime) begin
+(clock-gettime) unknown clock rejected
+(clock-gettime) read monotonic clock
+(clock-gettime) clock resolves time within a tick
+(clock-gettime) end
+clock-gettime: exit(0)
+EOF
+pass;
@@ -0,0 +1,33 @@
+/* Reserves real-time CPU bandwidth with sched_deadline() and
+   checks that admission control turns away inconsistent and
+   overloading reservations. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  int pid;
+
+  CHECK (sched_deadline (5, 3, 10) == -1,
+         "runtime longer than deadline rejected");
+  CHECK (sched_deadline (5, 10, 8) == -1,
+         "deadline longer than period rejected");
+  CHECK (sched_deadline (9, 10, 10) == 0, "reserve 90%% of the CPU");
+  CHECK (sched_deadline (8, 10, 10) == 0, "shrink reservation to 80%%");
+
+  if ((pid = fork ("child")) == 0)
+    {
+      CHECK (sched_deadline (2, 10, 10) == -1,
+             "child cannot reserve another 20%%");
+      CHECK (sched_deadline (1, 10, 10) == 0, "child reserves 10%%");
+      exit (0);
+    }
+  CHECK (wait (pid) == 0, "wait for child");
+
+  CHECK (sched_deadline (0, 0, 0) == 0, "leave the real-time class");
+  CHECK (sched_deadline (9, 10, 10) == 0, "reserve 90%% again");
+  sched_deadline (0, 0, 0);
+}
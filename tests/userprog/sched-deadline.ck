@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sched-deadline) begin
+(sched-deadline) runtime longer than deadline rejected
+(sched-deadline) deadline longer than period rejected
+(sched-deadline) reserve 90% of the CPU
+(sched-deadline) shrink reservation to 80%
+(sched-deadline) child cannot reserve another 20%
+(sched-deadline) child reserves 10%
+child: exit(0)
+(sched-deadline) wait for child
+(sched-deadline) leave the real-time class
+(sched-deadline) reserve 90% again
+(sched-deadline) end
+sched-deadline: exit(0)
+EOF
+pass;
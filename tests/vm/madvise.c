@@ -0,0 +1,37 @@
+/* Gives advice about an anonymous region with madvise(), then
+   checks that MADV_DONTNEED throws its contents away. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 8
+
+static char buf[PAGE_SIZE * PAGE_CNT] __attribute__ ((aligned (PAGE_SIZE)));
+
+void
+test_main (void)
+{
+  size_t i;
+
+  CHECK (madvise (buf, sizeof buf, MADV_SEQUENTIAL) == 0,
+         "madvise MADV_SEQUENTIAL");
+  memset (buf, 0x5a, sizeof buf);
+  CHECK (madvise (buf, sizeof buf, MADV_WILLNEED) == 0,
+         "madvise MADV_WILLNEED");
+  for (i = 0; i < sizeof buf; i++)
+    if (buf[i] != 0x5a)
+      fail ("byte %zu has value %02hhx (should be 5a)", i, buf[i]);
+
+  CHECK (madvise (buf, sizeof buf, MADV_DONTNEED) == 0,
+         "madvise MADV_DONTNEED");
+  for (i = 0; i < sizeof buf; i++)
+    if (buf[i] != 0)
+      fail ("byte %zu has value %02hhx (should be 0)", i, buf[i]);
+
+  CHECK (madvise (buf + 1, PAGE_SIZE, MADV_NORMAL) == -1,
+         "misaligned madvise must fail");
+  CHECK (madvise (buf, PAGE_SIZE, 42) == -1, "bad advice must fail");
+}
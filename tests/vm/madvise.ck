@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(madvise) begin
+(madvise) madvise MADV_SEQUENTIAL
+(madvise) madvise MADV_WILLNEED
+(madvise) madvise MADV_DONTNEED
+(madvise) misaligned madvise must fail
+(madvise) bad advice must fail
+(madvise) end
+EOF
+pass;
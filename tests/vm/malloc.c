@@ -0,0 +1,66 @@
+/* Exercises the user-space malloc(): many small blocks of every
+   size class, a large block that is mapped on its own, realloc()
+   growth across size classes, and reuse of freed blocks. */
+
+#include <malloc.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_CNT 256
+#define BIG_SIZE (64 * 1024)
+
+static char *blocks[BLOCK_CNT];
+
+static void
+check_fill (const char *p, size_t size, char c)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (p[i] != c)
+      fail ("byte %zu is %02hhx (should be %02hhx)", i, p[i], c);
+}
+
+void
+test_main (void)
+{
+  char *big, *p, *q;
+  size_t i;
+
+  for (i = 0; i < BLOCK_CNT; i++)
+    {
+      size_t size = 1 + i * 7 % 1500;
+      blocks[i] = malloc (size);
+      if (blocks[i] == NULL)
+        fail ("malloc of %zu bytes failed", size);
+      memset (blocks[i], i, size);
+    }
+  msg ("allocate small blocks");
+  for (i = 0; i < BLOCK_CNT; i++)
+    check_fill (blocks[i], 1 + i * 7 % 1500, i);
+  for (i = 0; i < BLOCK_CNT; i += 2)
+    free (blocks[i]);
+  msg ("free every other block");
+
+  big = calloc (BIG_SIZE, 1);
+  CHECK (big != NULL, "calloc %d bytes", BIG_SIZE);
+  check_fill (big, BIG_SIZE, 0);
+  memset (big, 0x42, BIG_SIZE);
+  check_fill (big, BIG_SIZE, 0x42);
+  free (big);
+  msg ("free big block");
+
+  p = malloc (10);
+  strlcpy (p, "realloc", 10);
+  q = realloc (p, 3000);
+  CHECK (q != NULL && !strcmp (q, "realloc"), "realloc to a big block");
+  free (q);
+
+  for (i = 1; i < BLOCK_CNT; i += 2)
+    check_fill (blocks[i], 1 + i * 7 % 1500, i);
+  for (i = 1; i < BLOCK_CNT; i += 2)
+    free (blocks[i]);
+  msg ("free remaining blocks");
+}
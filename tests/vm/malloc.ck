@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(malloc) begin
+(malloc) allocate small blocks
+(malloc) free every other block
+(malloc) calloc 65536 bytes
+(malloc) free big block
+(malloc) realloc to a big block
+(malloc) free remaining blocks
+(malloc) end
+EOF
+pass;
@@ -0,0 +1,29 @@
+/* Limits the resident set to a few frames with memlimit(), then
+   writes and re-reads a region several times larger, so that the
+   process has to swap its own pages to stay within its quota. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 64
+#define LIMIT 16
+
+static char buf[PAGE_SIZE * PAGE_CNT];
+
+void
+test_main (void)
+{
+  size_t i;
+
+  CHECK (memlimit (LIMIT) == 0, "memlimit %d pages", LIMIT);
+  for (i = 0; i < PAGE_CNT; i++)
+    memset (buf + i * PAGE_SIZE, i, PAGE_SIZE);
+  for (i = 0; i < sizeof buf; i++)
+    if (buf[i] != (char) (i / PAGE_SIZE))
+      fail ("byte %zu has value %02hhx (should be %02zx)",
+            i, buf[i], i / PAGE_SIZE);
+  CHECK (memlimit (0) == LIMIT, "lift memlimit");
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(memlimit) begin
+(memlimit) memlimit 16 pages
+(memlimit) lift memlimit
+(memlimit) end
+EOF
+pass;
@@ -0,0 +1,31 @@
+/* Writes through a mapping, calls msync(), and checks that the
+   file holds the new data while the mapping is still in place. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  static const char overwrite[] = "Written through a mapping and synced.\n";
+  char *actual = (char *) 0x10000000;
+  char buf[sizeof overwrite];
+  size_t len = strlen (overwrite);
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (mmap (actual, 4096, 1, handle, 0) != MAP_FAILED,
+         "mmap \"sample.txt\"");
+  memcpy (actual, overwrite, len);
+  CHECK (msync (actual, 4096) == 0, "msync mapping");
+
+  seek (handle, 0);
+  CHECK (read (handle, buf, len) == (int) len, "read \"sample.txt\"");
+  if (memcmp (buf, overwrite, len))
+    fail ("file does not hold the synced data");
+
+  munmap (actual);
+  close (handle);
+}
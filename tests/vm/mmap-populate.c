@@ -0,0 +1,32 @@
+/* Maps a file with MAP_POPULATE, so that it is loaded at mmap
+   time rather than on first touch, and checks its contents. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  int handle;
+  void *map;
+  size_t i;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (actual, 4096, MAP_POPULATE, handle, 0)) != MAP_FAILED,
+         "mmap \"sample.txt\" with MAP_POPULATE");
+
+  if (memcmp (actual, sample, strlen (sample)))
+    fail ("read of populated mapping reported bad data");
+
+  for (i = strlen (sample); i < 4096; i++)
+    if (actual[i] != 0)
+      fail ("byte %zu of populated mapping has value %02hhx (should be 0)",
+            i, actual[i]);
+
+  munmap (map);
+  close (handle);
+}
@@ -0,0 +1,39 @@
+/* Grows the heap with sbrk(), fills it, shrinks it again, and
+   checks that memory freed from the top comes back zeroed when
+   the heap is grown over it a second time. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 16
+
+void
+test_main (void)
+{
+  char *base, *p;
+  size_t i;
+
+  base = sbrk (0);
+  CHECK (base != (void *) -1, "sbrk (0)");
+  CHECK (sbrk (PAGE_SIZE * PAGE_CNT) == base, "grow heap by %d pages",
+         PAGE_CNT);
+  for (i = 0; i < PAGE_SIZE * PAGE_CNT; i++)
+    if (base[i] != 0)
+      fail ("byte %zu of new heap is %02hhx", i, base[i]);
+  memset (base, 0x5a, PAGE_SIZE * PAGE_CNT);
+
+  p = sbrk (-(PAGE_SIZE * PAGE_CNT / 2));
+  CHECK (p == base + PAGE_SIZE * PAGE_CNT, "shrink heap by half");
+  CHECK (sbrk (PAGE_SIZE * PAGE_CNT / 2) == base + PAGE_SIZE * PAGE_CNT / 2,
+         "grow heap again");
+  for (i = 0; i < PAGE_SIZE * PAGE_CNT; i++)
+    if (base[i] != (i < PAGE_SIZE * PAGE_CNT / 2 ? 0x5a : 0))
+      fail ("byte %zu of heap is %02hhx", i, base[i]);
+
+  CHECK (sbrk (-(base - (char *) 0) - PAGE_SIZE) == (void *) -1,
+         "shrink below heap start (must fail)");
+  CHECK (sbrk (0x48000000) == (void *) -1, "grow into stack (must fail)");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(sbrk) begin
+(sbrk) sbrk (0)
+(sbrk) grow heap by 16 pages
+(sbrk) shrink heap by half
+(sbrk) grow heap again
+(sbrk) shrink below heap start (must fail)
+(sbrk) grow into stack (must fail)
+(sbrk) end
+EOF
+pass;
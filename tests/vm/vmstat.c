@@ -0,0 +1,52 @@
+/* Touches zero-filled BSS pages and grows the stack, then checks
+   that vmstat() counted the faults and recorded their latency. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 16
+
+static char bss[PAGE_SIZE * PAGE_CNT];
+
+static void
+grow_stack (void)
+{
+  volatile char frame[PAGE_SIZE * PAGE_CNT];
+  size_t i;
+
+  for (i = 0; i < sizeof frame; i += PAGE_SIZE)
+    frame[i] = 1;
+}
+
+static uint64_t
+total_latency (const struct vmstat *st)
+{
+  uint64_t total = 0;
+  int i;
+
+  for (i = 0; i < VMSTAT_BUCKETS; i++)
+    total += st->latency[i];
+  return total;
+}
+
+void
+test_main (void)
+{
+  static struct vmstat before, after;
+  size_t i;
+
+  CHECK (vmstat (&before) == 0, "vmstat");
+  for (i = 0; i < PAGE_CNT; i++)
+    bss[i * PAGE_SIZE] = 1;
+  grow_stack ();
+  CHECK (vmstat (&after) == 0, "vmstat");
+
+  CHECK (after.proc.minor - before.proc.minor >= PAGE_CNT - 1,
+         "zero-fill faults counted");
+  CHECK (after.proc.stack > before.proc.stack, "stack growth counted");
+  CHECK (total_latency (&after) - total_latency (&before)
+         >= PAGE_CNT + 1, "fault latencies recorded");
+}
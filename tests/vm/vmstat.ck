@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(vmstat) begin
+(vmstat) vmstat
+(vmstat) vmstat
+(vmstat) zero-fill faults counted
+(vmstat) stack growth counted
+(vmstat) fault latencies recorded
+(vmstat) end
+EOF
+pass;
@@ -60,6 +60,9 @@ static void run_actions (char **argv);
 static void usage (void);
 
 static void print_stats (void);
+#ifdef VM
+static void parse_swap (char *value);
+#endif
 
 
 int main (void) NO_RETURN;
@@ -221,19 +224,50 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-cfs"))
+			thread_cfs = true;
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-thrash"))
+			vm_thrash_threshold = atoi (value);
+		else if (!strcmp (name, "-stack-pregrow"))
+			vm_stack_pregrow = atoi (value);
+		else if (!strcmp (name, "-swap"))
+			parse_swap (value);
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
 	}
 
+	if (thread_mlfqs && thread_cfs)
+		PANIC ("-mlfqs and -cfs cannot be used together");
+
 	return argv;
 }
 
+#ifdef VM
+/* Registers the swap device given as CHAN:DEV[:PRIO] by -swap. */
+static void
+parse_swap (char *value) {
+	char *save_ptr;
+	char *chan, *dev, *prio;
+
+	if (value == NULL)
+		PANIC ("-swap requires CHAN:DEV[:PRIO]");
+	chan = strtok_r (value, ":", &save_ptr);
+	dev = strtok_r (NULL, ":", &save_ptr);
+	prio = strtok_r (NULL, ":", &save_ptr);
+	if (chan == NULL || dev == NULL)
+		PANIC ("-swap requires CHAN:DEV[:PRIO]");
+	vm_swap_register (atoi (chan), atoi (dev), prio != NULL ? atoi (prio) : 0);
+}
+#endif
+
 /* Runs the task specified in ARGV[1]. */
 static void
 run_task (char **argv) {
@@ -326,8 +360,17 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -cfs               Use completely fair scheduler.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+			"  -thrash=COUNT      Suspend processes past COUNT evictions\n"
+			"                     per quarter second (0 to disable).\n"
+			"  -stack-pregrow=COUNT Map COUNT extra pages on stack growth.\n"
+			"  -swap=CHAN:DEV[:PRIO] Swap to disk DEV on channel CHAN.\n"
+			"                     Higher PRIO is used first; equal ones\n"
+			"                     are striped.  May be repeated.\n"
 #endif
 			);
 	power_off ();
@@ -362,4 +405,7 @@ print_stats (void) {
 #ifdef USERPROG
 	exception_print_stats ();
 #endif
+#ifdef VM
+	vm_print_stats ();
+#endif
 }
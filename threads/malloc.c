@@ -39,7 +39,7 @@ struct desc {
 	size_t block_size;          /* Size of each element in bytes. */
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
 	struct list free_list;      /* List of free blocks. */
-	struct lock lock;           /* Lock. */
+	struct mutex lock;          /* Mutex. */
 };
 
 /* Magic number for detecting arena corruption. */
@@ -75,7 +75,7 @@ malloc_init (void) {
 		d->block_size = block_size;
 		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
 		list_init (&d->free_list);
-		lock_init (&d->lock);
+		mutex_init (&d->lock);
 	}
 }
 
@@ -112,7 +112,7 @@ malloc (size_t size) {
 		return a + 1;
 	}
 
-	lock_acquire (&d->lock);
+	mutex_lock (&d->lock);
 
 	/* If the free list is empty, create a new arena. */
 	if (list_empty (&d->free_list)) {
@@ -121,7 +121,7 @@ malloc (size_t size) {
 		/* Allocate a page. */
 		a = palloc_get_page (0);
 		if (a == NULL) {
-			lock_release (&d->lock);
+			mutex_unlock (&d->lock);
 			return NULL;
 		}
 
@@ -139,7 +139,7 @@ malloc (size_t size) {
 	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
 	a = block_to_arena (b);
 	a->free_cnt--;
-	lock_release (&d->lock);
+	mutex_unlock (&d->lock);
 	return b;
 }
 
@@ -213,7 +213,7 @@ free (void *p) {
 			memset (b, 0xcc, d->block_size);
 #endif
 
-			lock_acquire (&d->lock);
+			mutex_lock (&d->lock);
 
 			/* Add block to free list. */
 			list_push_front (&d->free_list, &b->free_elem);
@@ -230,7 +230,7 @@ free (void *p) {
 				palloc_free_page (a);
 			}
 
-			lock_release (&d->lock);
+			mutex_unlock (&d->lock);
 		} else {
 			/* It's a big block.  Free its pages. */
 			palloc_free_multiple (a, a->free_cnt);
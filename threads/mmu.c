@@ -156,31 +156,35 @@ pml4_for_each (uint64_t *pml4, pte_for_each_func *func, void *aux) {
 }
 
 static void
-pt_destroy (uint64_t *pt) {
+pt_destroy (uint64_t *pt, pml4_page_func *func, void *aux) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pt[i]);
-		if (((uint64_t) pte) & PTE_P)
-			palloc_free_page ((void *) PTE_ADDR (pte));
+		if (((uint64_t) pte) & PTE_P) {
+			if (func != NULL)
+				func ((void *) PTE_ADDR (pte), aux);
+			else
+				palloc_free_page ((void *) PTE_ADDR (pte));
+		}
 	}
 	palloc_free_page ((void *) pt);
 }
 
 static void
-pgdir_destroy (uint64_t *pdp) {
+pgdir_destroy (uint64_t *pdp, pml4_page_func *func, void *aux) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
 		if (((uint64_t) pte) & PTE_P)
-			pt_destroy (PTE_ADDR (pte));
+			pt_destroy (PTE_ADDR (pte), func, aux);
 	}
 	palloc_free_page ((void *) pdp);
 }
 
 static void
-pdpe_destroy (uint64_t *pdpe) {
+pdpe_destroy (uint64_t *pdpe, pml4_page_func *func, void *aux) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pde = ptov((uint64_t *) pdpe[i]);
 		if (((uint64_t) pde) & PTE_P)
-			pgdir_destroy ((void *) PTE_ADDR (pde));
+			pgdir_destroy ((void *) PTE_ADDR (pde), func, aux);
 	}
 	palloc_free_page ((void *) pdpe);
 }
@@ -188,6 +192,14 @@ pdpe_destroy (uint64_t *pdpe) {
 /* Destroys pml4e, freeing all the pages it references. */
 void
 pml4_destroy (uint64_t *pml4) {
+	pml4_destroy_with (pml4, NULL, NULL);
+}
+
+/* Destroys pml4e like pml4_destroy(), but passes each page it maps
+   to FUNC, along with AUX, instead of freeing it.  The page tables
+   themselves are freed in the same walk. */
+void
+pml4_destroy_with (uint64_t *pml4, pml4_page_func *func, void *aux) {
 	if (pml4 == NULL)
 		return;
 	ASSERT (pml4 != base_pml4);
@@ -195,7 +207,7 @@ pml4_destroy (uint64_t *pml4) {
 	/* if PML4 (vaddr) >= 1, it's kernel space by define. */
 	uint64_t *pdpe = ptov ((uint64_t *) pml4[0]);
 	if (((uint64_t) pdpe) & PTE_P)
-		pdpe_destroy ((void *) PTE_ADDR (pdpe));
+		pdpe_destroy ((void *) PTE_ADDR (pdpe), func, aux);
 	palloc_free_page ((void *) pml4);
 }
 
@@ -28,7 +28,7 @@
 
 /* A memory pool. */
 struct pool {
-	struct lock lock;               /* Mutual exclusion. */
+	struct mutex lock;              /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
 	uint8_t *base;                  /* Base of pool. */
 };
@@ -263,9 +263,9 @@ void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
 
-	lock_acquire (&pool->lock);
+	mutex_lock (&pool->lock);
 	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
+	mutex_unlock (&pool->lock);
 	void *pages;
 
 	if (page_idx != BITMAP_ERROR)
@@ -328,6 +328,15 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Stores the first page of the user pool in *BASE and the number of
+   pages it spans in *PAGE_CNT.  Every page that palloc_get_page()
+   returns for PAL_USER lies in that range. */
+void
+palloc_user_pool (void **base, size_t *page_cnt) {
+	*base = user_pool.base;
+	*page_cnt = bitmap_size (user_pool.used_map);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
@@ -337,7 +346,7 @@ init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
 	uint64_t pgcnt = (end - start) / PGSIZE;
 	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
 
-	lock_init(&p->lock);
+	mutex_init(&p->lock);
 	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
 	p->base = (void *) start;
 
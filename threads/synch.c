@@ -32,6 +32,17 @@
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
+/* Returns true if the thread waiting through A has a lower
+   priority than the one waiting through B. */
+static bool
+waiter_less (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = heap_entry (a_, struct thread, sema_elem);
+	const struct thread *b = heap_entry (b_, struct thread, sema_elem);
+
+	return a->priority < b->priority;
+}
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -46,7 +57,7 @@ sema_init (struct semaphore *sema, unsigned value) {
 	ASSERT (sema != NULL);
 
 	sema->value = value;
-	list_init (&sema->waiters);
+	heap_init (&sema->waiters, waiter_less, NULL);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -66,7 +77,10 @@ sema_down (struct semaphore *sema) {
 
 	old_level = intr_disable ();
 	while (sema->value == 0) {
-      list_insert_ordered(&sema->waiters, &thread_current()->elem, priority_more, NULL);
+		struct thread *curr = thread_current ();
+
+		curr->waiting_sema = sema;
+		heap_insert (&sema->waiters, &curr->sema_elem);
 		thread_block ();
 	}
 	sema->value--;
@@ -109,9 +123,12 @@ sema_up (struct semaphore *sema) {
 	ASSERT (sema != NULL);
 
 	old_level = intr_disable ();
-	if (!list_empty (&sema->waiters)) {
-		list_sort(&sema->waiters, priority_more, NULL);
-		thread_unblock (list_entry (list_pop_front (&sema->waiters), struct thread, elem));
+	if (!heap_empty (&sema->waiters)) {
+		struct thread *t = heap_entry (heap_pop (&sema->waiters),
+				struct thread, sema_elem);
+
+		t->waiting_sema = NULL;
+		thread_unblock (t);
 	}
 	sema->value++;
  
@@ -120,6 +137,23 @@ sema_up (struct semaphore *sema) {
 	intr_set_level (old_level);
 }
 
+/* Moves thread T to its new place in the queue of the semaphore
+   or condition variable it is waiting on, if any, after its
+   priority changed. */
+void
+sema_requeue (struct thread *t) {
+	enum intr_level old_level;
+
+	ASSERT (t != NULL);
+
+	old_level = intr_disable ();
+	if (t->waiting_sema != NULL)
+		heap_update (&t->waiting_sema->waiters, &t->sema_elem);
+	if (t->waiting_cond != NULL)
+		heap_update (&t->waiting_cond->waiters, t->cond_elem);
+	intr_set_level (old_level);
+}
+
 static void sema_test_helper (void *sema_);
 
 /* Self-test for semaphores that makes control "ping-pong"
@@ -175,22 +209,44 @@ lock_init (struct lock *lock) {
 	ASSERT (lock != NULL);
 
 	lock->holder = NULL;
+	lock->priority = PRI_MIN - 1;
 	sema_init (&lock->semaphore, 1);
 }
 
-
 /* inversion */
+/* Orders a thread's held_locks so that the lock with the
+   highest-priority waiter is on top. */
 bool
-donations_priority_more (const struct list_elem *a_, const struct list_elem *b_,
-            void *aux UNUSED) { 
-	struct thread *a = list_entry (a_, struct thread, donations_elem);
-	struct thread *b = list_entry (b_, struct thread, donations_elem);
+lock_priority_less (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct lock *a = heap_entry (a_, struct lock, elem);
+	const struct lock *b = heap_entry (b_, struct lock, elem);
 
-	return a->priority > b->priority;
+	return a->priority < b->priority;
 }
 
-
-
+/* Makes the current thread the holder of LOCK, which it has just
+   taken.  Threads still waiting for LOCK now donate to it.
+   Interrupts must be off. */
+static void
+lock_take (struct lock *lock) {
+	struct thread *curr = thread_current ();
+	struct heap *waiters = &lock->semaphore.waiters;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	lock->holder = curr;
+	if (thread_mlfqs)
+		return;
+
+	lock->priority = PRI_MIN - 1;
+	if (!heap_empty (waiters))
+		lock->priority = heap_entry (heap_top (waiters), struct thread,
+				sema_elem)->priority;
+	heap_insert (&curr->held_locks, &lock->elem);
+	if (curr->priority < lock->priority)
+		curr->priority = lock->priority;
+}
 
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
@@ -203,31 +259,30 @@ donations_priority_more (const struct list_elem *a_, const struct list_elem *b_,
 void
 lock_acquire (struct lock *lock)
 {
+  struct thread *curr = thread_current ();
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
+  // holder 확인부터 잠들 때까지 holder가 lock을 놓지 못하게 인터럽트를 끈다.
+  old_level = intr_disable ();
+
   //mlfqs 스케줄러 활성화시 priority donation 비활성
   //해당 lock의 holder가 존재한다면 아래작업을 수행한다.
-  if(!thread_mlfqs) {
-    if (lock->holder != NULL) {
-      //현재 thread의 wait_on_lock 변수에 획득하기를 기다리는 lock의 주소를 저장
-      thread_current()->waiting_lock = lock;
-
-      //multiple donation을 고려하기위해 이전상태의 우선순위를 기억
-      //donation을 받은 thread의 thread 구조체를 list로 관리
-      list_push_back(&lock->holder->donations, &thread_current()->donations_elem);
-      //priority donation을 수행하기 위해 donate_priority()함수를 호출
-      donate_priority();
-    }
+  if (!thread_mlfqs && lock->holder != NULL) {
+    //현재 thread의 wait_on_lock 변수에 획득하기를 기다리는 lock의 주소를 저장
+    curr->waiting_lock = lock;
+    //lock 사슬을 따라 priority donation을 수행
+    donate_priority ();
   }
   sema_down (&lock->semaphore);
-  if(!thread_mlfqs) {
-    thread_current()->waiting_lock = NULL;
-  }
-  //lock을 획득한 후 lock holder를 갱신한다.
-  lock->holder = thread_current ();
+  curr->waiting_lock = NULL;
 
+  //lock을 획득한 후 lock holder를 갱신한다.
+  lock_take (lock);
+  intr_set_level (old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -238,14 +293,17 @@ lock_acquire (struct lock *lock)
    interrupt handler. */
 bool
 lock_try_acquire (struct lock *lock) {
+	enum intr_level old_level;
 	bool success;
 
 	ASSERT (lock != NULL);
 	ASSERT (!lock_held_by_current_thread (lock));
 
+	old_level = intr_disable ();
 	success = sema_try_down (&lock->semaphore);
 	if (success)
-		lock->holder = thread_current ();
+		lock_take (lock);
+	intr_set_level (old_level);
 	return success;
 }
 
@@ -257,16 +315,22 @@ lock_try_acquire (struct lock *lock) {
    handler. */
 void
 lock_release (struct lock *lock) {
+	enum intr_level old_level;
+
 	ASSERT (lock != NULL);
 	ASSERT (lock_held_by_current_thread (lock));
-   
-   if (!thread_mlfqs) {
-      remove_with_lock(lock);
-      refresh_priority();
-   }
 
-   lock->holder = NULL;
-   sema_up (&lock->semaphore);
+	old_level = intr_disable ();
+	// 이 lock으로 받은 donation만 빠지도록 held_locks에서 꺼내고 다시 계산
+	if (!thread_mlfqs) {
+		heap_remove (&thread_current ()->held_locks, &lock->elem);
+		lock->priority = PRI_MIN - 1;
+		refresh_priority ();
+	}
+
+	lock->holder = NULL;
+	sema_up (&lock->semaphore);
+	intr_set_level (old_level);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -279,12 +343,276 @@ lock_held_by_current_thread (const struct lock *lock) {
 	return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
+/* Initializes readers-writer lock RW as free. */
+void
+rwlock_init (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	lock_init (&rw->wlock);
+	list_init (&rw->readers);
+	rw->draining = false;
+	sema_init (&rw->drained, 0);
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or is
+   waiting for earlier readers to leave.  READER records the hold
+   and must stay valid until the matching rwlock_release_read().
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw, struct rwlock_reader *reader) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (reader != NULL);
+	ASSERT (!intr_context ());
+
+	lock_acquire (&rw->wlock);
+	old_level = intr_disable ();
+	lock_init (&reader->hold);
+	reader->hold.holder = curr;
+	list_push_back (&rw->readers, &reader->elem);
+	if (!thread_mlfqs)
+		heap_insert (&curr->held_locks, &reader->hold.elem);
+	intr_set_level (old_level);
+	lock_release (&rw->wlock);
+}
+
+/* Releases RW, which the current thread holds for reading through
+   READER, dropping whatever a waiting writer donated to it.  The
+   last reader to leave wakes a writer that is waiting. */
+void
+rwlock_release_read (struct rwlock *rw, struct rwlock_reader *reader) {
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (reader != NULL);
+	ASSERT (reader->hold.holder == thread_current ());
+
+	old_level = intr_disable ();
+	list_remove (&reader->elem);
+	reader->hold.holder = NULL;
+	if (!thread_mlfqs) {
+		heap_remove (&thread_current ()->held_locks, &reader->hold.elem);
+		refresh_priority ();
+	}
+	if (list_empty (&rw->readers) && rw->draining) {
+		rw->draining = false;
+		sema_up (&rw->drained);
+	} else
+		test_max_priority ();
+	intr_set_level (old_level);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it.  Readers that arrive meanwhile wait behind us, and the
+   readers still inside run with our priority until they leave.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+
+	lock_acquire (&rw->wlock);
+	old_level = intr_disable ();
+	if (!list_empty (&rw->readers)) {
+		rw->draining = true;
+		curr->waiting_rwlock = rw;
+		rwlock_donate (rw, curr->priority);
+		sema_down (&rw->drained);
+		curr->waiting_rwlock = NULL;
+	}
+	intr_set_level (old_level);
+}
+
+/* Donates PRIORITY to every reader inside RW, on behalf of the
+   writer waiting for them to leave.  Interrupts must be off. */
+void
+rwlock_donate (struct rwlock *rw, int priority) {
+	struct list_elem *e;
+
+	ASSERT (rw != NULL);
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (thread_mlfqs)
+		return;
+
+	for (e = list_begin (&rw->readers); e != list_end (&rw->readers);
+	     e = list_next (e))
+		donate_lock_priority (&list_entry (e, struct rwlock_reader,
+					elem)->hold, priority);
+}
+
+/* Releases RW, which the current thread holds for writing. */
+void
+rwlock_release_write (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	lock_release (&rw->wlock);
+}
+
+/* Returns true if the current thread holds RW for writing. */
+bool
+rwlock_held_for_write (const struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	return lock_held_by_current_thread (&rw->wlock);
+}
+
+/* Set in a mutex's owner word while threads sleep on it, so that
+   the owner's unlock takes the slow path and wakes one of them. */
+#define MUTEX_WAITERS ((uintptr_t) 1)
+
+/* Most times a contending thread polls a running owner before
+   going to sleep. */
+#define MUTEX_SPIN_LIMIT 1000
+
+/* Atomically replaces M's owner word by NEW if it is OLD.
+   Returns true if it did. */
+static inline bool
+mutex_cas (struct mutex *m, uintptr_t old, uintptr_t new) {
+	return __atomic_compare_exchange_n (&m->owner, &old, new, false,
+			__ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+/* Returns the thread that owns M, or a null pointer. */
+static inline struct thread *
+mutex_owner (const struct mutex *m) {
+	uintptr_t owner = __atomic_load_n (&m->owner, __ATOMIC_RELAXED);
+	return (struct thread *) (owner & ~MUTEX_WAITERS);
+}
+
+/* Initializes mutex M as unlocked. */
+void
+mutex_init (struct mutex *m) {
+	ASSERT (m != NULL);
+
+	m->owner = 0;
+	sema_init (&m->sema, 0);
+}
+
+/* Acquires M, spinning or sleeping until it becomes available
+   if necessary.  M must not already be held by the current
+   thread.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+mutex_lock (struct mutex *m) {
+	uintptr_t curr = (uintptr_t) thread_current ();
+	enum intr_level old_level;
+	int spins;
+
+	ASSERT (m != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (!mutex_held_by_current_thread (m));
+
+	if (mutex_cas (m, 0, curr))
+		return;
+
+	/* The owner will likely release soon if it is running on
+	   another CPU; sleeping would cost more than waiting.  The
+	   owner of a contended mutex can never be running on this
+	   CPU, so a uniprocessor goes straight to sleep. */
+	for (spins = 0; spins < MUTEX_SPIN_LIMIT; spins++) {
+		struct thread *owner = mutex_owner (m);
+
+		if (owner == NULL) {
+			if (mutex_cas (m, 0, curr))
+				return;
+		} else if (owner->status != THREAD_RUNNING)
+			break;
+		asm volatile ("pause");
+	}
+
+	/* Sleep until the owner hands the mutex off.  Interrupts stay
+	   off so that checking the owner word and going to sleep are
+	   atomic with respect to mutex_unlock(). */
+	old_level = intr_disable ();
+	for (;;) {
+		uintptr_t owner = m->owner;
+
+		if (owner == 0) {
+			/* Keep the flag if others are still asleep. */
+			uintptr_t mine = curr;
+			if (!heap_empty (&m->sema.waiters))
+				mine |= MUTEX_WAITERS;
+			if (mutex_cas (m, 0, mine))
+				break;
+		} else if ((owner & MUTEX_WAITERS) != 0
+				|| mutex_cas (m, owner, owner | MUTEX_WAITERS))
+			sema_down (&m->sema);
+	}
+	intr_set_level (old_level);
+}
+
+/* Tries to acquire M and returns true if successful or false on
+   failure.  M must not already be held by the current thread.
+
+   This function will not sleep, so it may be called within an
+   interrupt handler. */
+bool
+mutex_trylock (struct mutex *m) {
+	ASSERT (m != NULL);
+	ASSERT (!mutex_held_by_current_thread (m));
+
+	return mutex_cas (m, 0, (uintptr_t) thread_current ());
+}
+
+/* Releases M, which must be owned by the current thread, and
+   wakes the highest-priority thread sleeping on it, if any. */
+void
+mutex_unlock (struct mutex *m) {
+	uintptr_t curr = (uintptr_t) thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (m != NULL);
+	ASSERT (mutex_held_by_current_thread (m));
+
+	if (__atomic_compare_exchange_n (&m->owner, &curr, 0, false,
+				__ATOMIC_RELEASE, __ATOMIC_RELAXED))
+		return;
+
+	old_level = intr_disable ();
+	__atomic_store_n (&m->owner, 0, __ATOMIC_RELEASE);
+	if (!heap_empty (&m->sema.waiters))
+		sema_up (&m->sema);
+	intr_set_level (old_level);
+}
+
+/* Returns true if the current thread holds M, false otherwise. */
+bool
+mutex_held_by_current_thread (const struct mutex *m) {
+	ASSERT (m != NULL);
+
+	return mutex_owner (m) == thread_current ();
+}
+
+/* One semaphore in a condition's heap. */
 struct semaphore_elem {
-	struct list_elem elem;              /* List element. */
+	struct heap_elem elem;              /* Heap element. */
 	struct semaphore semaphore;         /* This semaphore. */
+	struct thread *thread;              /* Thread waiting on it. */
 };
 
+/* Returns true if the thread waiting through A has a lower
+   priority than the one waiting through B. */
+static bool
+cond_waiter_less (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct semaphore_elem *a = heap_entry (a_, struct semaphore_elem, elem);
+	const struct semaphore_elem *b = heap_entry (b_, struct semaphore_elem, elem);
+
+	return a->thread->priority < b->thread->priority;
+}
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -292,18 +620,7 @@ void
 cond_init (struct condition *cond) {
 	ASSERT (cond != NULL);
 
-	list_init (&cond->waiters);
-}
-
-bool
-sema_priority_more (const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED) { 
-	const struct semaphore_elem *a = list_entry (a_, struct semaphore_elem, elem);
-	const struct semaphore_elem *b = list_entry (b_, struct semaphore_elem, elem);
-
-	const struct list *waiter_a = &(a->semaphore.waiters);
-	const struct list *waiter_b = &(b->semaphore.waiters);
-
-	return priority_more(list_begin(waiter_a), list_begin(waiter_b), NULL);
+	heap_init (&cond->waiters, cond_waiter_less, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -328,7 +645,9 @@ sema_priority_more (const struct list_elem *a_, const struct list_elem *b_, void
    we need to sleep. */
 void
 cond_wait (struct condition *cond, struct lock *lock) {
+	struct thread *curr = thread_current ();
 	struct semaphore_elem waiter;
+	enum intr_level old_level;
 
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
@@ -336,7 +655,15 @@ cond_wait (struct condition *cond, struct lock *lock) {
 	ASSERT (lock_held_by_current_thread (lock));
 
 	sema_init (&waiter.semaphore, 0);
-   list_insert_ordered(&cond->waiters, &waiter.elem, sema_priority_more, NULL);
+	waiter.thread = curr;
+
+	/* A donation may requeue us without holding LOCK. */
+	old_level = intr_disable ();
+	curr->waiting_cond = cond;
+	curr->cond_elem = &waiter.elem;
+	heap_insert (&cond->waiters, &waiter.elem);
+	intr_set_level (old_level);
+
 	lock_release (lock);
 	sema_down (&waiter.semaphore);
 	lock_acquire (lock);
@@ -351,15 +678,24 @@ cond_wait (struct condition *cond, struct lock *lock) {
    interrupt handler. */
 void
 cond_signal (struct condition *cond, struct lock *lock UNUSED) {
+	struct semaphore_elem *waiter = NULL;
+	enum intr_level old_level;
+
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	if (!list_empty (&cond->waiters)) {
-		list_sort(&cond->waiters, sema_priority_more, NULL);
-		sema_up (&list_entry (list_pop_front (&cond->waiters), struct semaphore_elem, elem)->semaphore);
+	old_level = intr_disable ();
+	if (!heap_empty (&cond->waiters)) {
+		waiter = heap_entry (heap_pop (&cond->waiters),
+				struct semaphore_elem, elem);
+		waiter->thread->waiting_cond = NULL;
 	}
+	intr_set_level (old_level);
+
+	if (waiter != NULL)
+		sema_up (&waiter->semaphore);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -373,6 +709,6 @@ cond_broadcast (struct condition *cond, struct lock *lock) {
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 
-	while (!list_empty (&cond->waiters))
+	while (!heap_empty (&cond->waiters))
 		cond_signal (cond, lock);
 }
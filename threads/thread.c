@@ -10,6 +10,7 @@
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #include "intrinsic.h"
 #include "threads/fixed_point.h"
 #ifdef USERPROG
@@ -29,13 +30,21 @@
    가장 이른 알람시간 ≤ 현재 ticks 이면, 깨울 스레드가 없다는 의미이다. */
 extern int64_t MIN_alarm_time;
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Lists of processes in THREAD_READY state, that is, processes
+   that are ready to run but not actually running, one per
+   priority.  Bit P of ready_mask is set whenever ready_queues[P]
+   is nonempty; a set bit may be stale and is cleared when found
+   so. */
+static struct list ready_queues[PRI_MAX + 1];
+static uint64_t ready_mask;
 
 /* 준비 상태 이전의 대기큐입니다. */
 static struct list sleep_list;
 
+/* List of all threads.  Threads are added to this list when they
+   are created and removed when they exit. */
+static struct list all_list;
+
 /* Idle thread. */
 static struct thread *idle_thread;
 
@@ -63,7 +72,81 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 bool thread_mlfqs;
 int load_avg;
 
+/* Number of threads in the run queues, so that the load average does
+   not have to count them. */
+static int ready_cnt;
+
+/* recent_cpu decays once a second, but only the running and ready
+   threads are decayed on time.  Every other thread catches up when
+   it is next examined, using the coefficients of the seconds it
+   missed.  A thread that missed more than DECAY_HISTORY seconds
+   has the oldest coefficient applied to the rest. */
+#define DECAY_HISTORY 64
+static int64_t mlfqs_epoch;                 /* Seconds decayed so far. */
+static int decay_coef[DECAY_HISTORY];       /* Coefficient of each second. */
+
+/* If true, use the completely fair scheduler.
+   Controlled by kernel command-line option "-cfs". */
+bool thread_cfs;
+
+/* Completely fair scheduler.  Ready threads wait in cfs_queue
+   ordered by virtual runtime, the CPU time they have used scaled
+   by NICE0_WEIGHT over the weight of their nice value, and the
+   one that has run least goes next.  Each thread's slice is its
+   weight's share of CFS_LATENCY, but at least
+   CFS_MIN_GRANULARITY. */
+#define CFS_LATENCY 8               /* Ticks in which all ready threads run. */
+#define CFS_MIN_GRANULARITY 1       /* Shortest slice, in ticks. */
+#define CFS_WAKEUP_GRANULARITY 1    /* Lead, in ticks, to preempt on wakeup. */
+#define NICE0_WEIGHT 1024
+#define TICK_VRUNTIME 1024          /* vruntime of one tick at nice 0. */
+static struct heap cfs_queue;       /* Ready threads, least vruntime on top. */
+static uint64_t min_vruntime;       /* Monotonic floor of ready vruntimes. */
+static unsigned long cfs_load;      /* Sum of the weights in cfs_queue. */
+
+/* Weight of each nice value from NICE_MIN to NICE_MAX.  Each step
+   is about 1.25x, so one nice level is worth about 10% of CPU. */
+static const int nice_to_weight[NICE_MAX - NICE_MIN + 1] = {
+	88761, 71755, 56483, 46273, 36291, 29154, 23254, 18705, 14949, 11916,
+	 9548,  7620,  6100,  4904,  3906,  3121,  2501,  1991,  1586,  1277,
+	 1024,   820,   655,   526,   423,   335,   272,   215,   172,   137,
+	  110,    87,    70,    56,    45,    36,    29,    23,    18,    15,
+	   12,
+};
+
+static bool cfs_less (const struct heap_elem *, const struct heap_elem *,
+		void *aux);
+
+/* Earliest deadline first.  A thread that reserved dl_runtime
+   ticks in every dl_period with thread_set_deadline() runs ahead
+   of every other thread, earliest absolute deadline first.  Once
+   it has used up its budget it is throttled until its next period
+   begins.  Admission control keeps the reserved bandwidth at or
+   below DL_BW_LIMIT, so every admitted thread meets its
+   deadlines. */
+#define DL_BW_SHIFT 20                       /* Bandwidth fraction bits. */
+#define DL_BW_LIMIT ((1 << DL_BW_SHIFT) * 95 / 100)
+static struct heap dl_queue;        /* Ready RT threads, earliest deadline on top. */
+static struct list dl_throttled;    /* Throttled RT threads, by next period. */
+static uint64_t dl_total_bw;        /* Sum of admitted runtime / period. */
+
+static bool dl_less (const struct heap_elem *, const struct heap_elem *,
+		void *aux);
+static bool dl_period_less (const struct list_elem *, const struct list_elem *,
+		void *aux);
+
 static void kernel_thread (thread_func *, void *aux);
+static void ready_push (struct thread *);
+static void ready_requeue (struct thread *);
+static struct thread *ready_pop (void);
+static int ready_top_priority (void);
+static int cfs_weight (const struct thread *);
+static unsigned cfs_slice (const struct thread *);
+static void cfs_charge (struct thread *);
+static bool dl_preempts (const struct thread *);
+static void dl_wakeup (struct thread *);
+static void dl_replenish (void);
+static uint64_t dl_bw (int64_t runtime, int64_t period);
 
 static void idle (void *aux UNUSED);
 static struct thread *next_thread_to_run (void);
@@ -116,9 +199,14 @@ thread_init (void) {
 
 	/* Init the globla thread context */
 	lock_init (&tid_lock);
-	list_init (&ready_list);
+	for (int i = PRI_MIN; i <= PRI_MAX; i++)
+		list_init (&ready_queues[i]);
 	list_init (&sleep_list);
 	list_init (&destruction_req);
+	list_init (&all_list);
+	heap_init (&cfs_queue, cfs_less, NULL);
+	heap_init (&dl_queue, dl_less, NULL);
+	list_init (&dl_throttled);
 
 	/* Set up a thread structure for the running thread. */
 	initial_thread = running_thread ();
@@ -144,25 +232,50 @@ thread_start (void) {
 	sema_down (&idle_started);
 }
 
-/* Called by the timer interrupt handler at each timer tick.
-   Thus, this function runs in an external interrupt context. */
+/* Called by the timer interrupt handler at each timer tick, with
+   the ELAPSED ticks since its last call: more than one after the
+   CPU idled with the timer stretched.  Thus, this function runs in
+   an external interrupt context. */
 void
-thread_tick (void) {
+thread_tick (int64_t elapsed) {
 	struct thread *t = thread_current();
 
 	/* Update statistics. */
 	if (t == idle_thread)
-		idle_ticks++;
+		idle_ticks += elapsed;
 #ifdef USERPROG
 	else if (t->pml4 != NULL)
-		user_ticks++;
+		user_ticks += elapsed;
 #endif
 	else
-		kernel_ticks++;
+		kernel_ticks += elapsed;
+
+	dl_replenish ();
+
+	/* Real-time threads run until they block, an earlier deadline
+	   arrives or their budget runs out. */
+	if (t->dl_runtime > 0) {
+		t->dl_budget -= elapsed;
+		if (t->dl_budget <= 0) {
+			t->dl_throttled = true;
+			intr_yield_on_return ();
+		}
+		return;
+	}
 
 	/* Enforce preemption. */
-	if (++thread_ticks >= TIME_SLICE)
-		intr_yield_on_return ();
+	if (thread_cfs) {
+		if (t != idle_thread)
+			for (int64_t i = 0; i < elapsed; i++)
+				cfs_charge (t);
+		thread_ticks += elapsed;
+		if (thread_ticks >= cfs_slice (t) && ready_cnt > 0)
+			intr_yield_on_return ();
+	} else {
+		thread_ticks += elapsed;
+		if (thread_ticks >= TIME_SLICE)
+			intr_yield_on_return ();
+	}
 }
 
 /* Prints thread statistics. */
@@ -218,14 +331,10 @@ thread_create (const char *name, int priority,
 	/* process */
 	list_push_back(&thread_current()->child_list, &t->child_elem);
 	
+#ifdef USERPROG
 	/* filesys */
-	t->fd_table = palloc_get_multiple(PAL_ZERO, FDT_PAGES);
-	if (t->fd_table == NULL) {
-		return TID_ERROR;
-	}
-	t->fd_idx = 2;
-	t->fd_table[0] = 1;
-	t->fd_table[1] = 2;
+	fd_table_init (&t->fds);
+#endif
 
 	/* Add to run queue. */
 	thread_unblock (t);
@@ -262,13 +371,32 @@ priority_more (const struct list_elem *a_, const struct list_elem *b_,
 
 void 
 test_max_priority(void) {
-	if (!list_empty(&ready_list)) {
-		struct thread *top_pri = list_begin(&ready_list);
-		if (!intr_context() && priority_more(top_pri, &thread_current()->elem, NULL))
-		{
+	// 실시간 스레드는 일반 스레드보다 항상 먼저, 서로는 마감이 이른 순서로 실행된다.
+	if (!heap_empty(&dl_queue) && !intr_context()) {
+		struct thread *next = heap_entry(heap_top(&dl_queue), struct thread, dl_elem);
+		if (dl_preempts(next)) {
 			thread_yield();
+			return;
 		}
 	}
+	if (thread_current()->dl_runtime > 0) {
+		return;
+	}
+
+	// CFS: 깨어난 스레드가 현재 스레드보다 충분히 덜 실행됐으면 양보한다.
+	if (thread_cfs) {
+		if (!heap_empty(&cfs_queue) && !intr_context()) {
+			struct thread *next = heap_entry(heap_top(&cfs_queue), struct thread, cfs_elem);
+			if (next->vruntime + CFS_WAKEUP_GRANULARITY * TICK_VRUNTIME
+			    < thread_current()->vruntime) {
+				thread_yield();
+			}
+		}
+		return;
+	}
+	if (!intr_context() && ready_top_priority() > thread_current()->priority) {
+		thread_yield();
+	}
 }
 
 /* Transitions a blocked thread T to the ready-to-run state.
@@ -287,8 +415,26 @@ thread_unblock (struct thread *t) {
 
 	old_level = intr_disable ();
 	ASSERT (t->status == THREAD_BLOCKED);
-  	list_insert_ordered(&ready_list, &t->elem, priority_more, NULL);
+	if (thread_mlfqs) {
+		mlfqs_recent_cpu(t);
+		mlfqs_priority(t);
+	}
+	// 오래 잔 스레드가 밀린 만큼 CPU를 독점하지 않도록 크레딧을 반 latency로 제한
+	if (thread_cfs) {
+		uint64_t floor = min_vruntime - CFS_LATENCY * TICK_VRUNTIME / 2;
+		if (min_vruntime > CFS_LATENCY * TICK_VRUNTIME / 2 && t->vruntime < floor) {
+			t->vruntime = floor;
+		}
+	}
+	if (t->dl_runtime > 0) {
+		dl_wakeup(t);
+	}
+	ready_push(t);
 	t->status = THREAD_READY;
+	// 타이머 등 인터럽트에서 깨어난 실시간 스레드는 다음 틱까지 기다리지 않는다.
+	if (intr_context() && t->dl_runtime > 0 && dl_preempts(t)) {
+		intr_yield_on_return();
+	}
 	intr_set_level (old_level);
 }
 
@@ -359,10 +505,28 @@ thread_exit (void) {
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
 	intr_disable ();
+	list_remove (&thread_current ()->allelem);
+	dl_total_bw -= dl_bw (thread_current ()->dl_runtime,
+			thread_current ()->dl_period);
 	do_schedule (THREAD_DYING);
 	NOT_REACHED ();
 }
 
+/* Invoke function 'func' on all threads, passing along 'aux'.
+   This function must be called with interrupts off. */
+void
+thread_foreach (thread_action_func *func, void *aux) {
+	struct list_elem *e;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (e = list_begin (&all_list); e != list_end (&all_list);
+			e = list_next (e)) {
+		struct thread *t = list_entry (e, struct thread, allelem);
+		func (t, aux);
+	}
+}
+
 /* Yields the CPU.  The current thread is not put to sleep and
    may be scheduled again immediately at the scheduler's whim. */
 void
@@ -374,7 +538,7 @@ thread_yield (void) {
 
 	old_level = intr_disable ();
 	if (curr != idle_thread)
-    	list_insert_ordered(&ready_list, &curr->elem, priority_more, NULL);
+		ready_push (curr);
 	do_schedule (THREAD_READY);
 	intr_set_level (old_level);
 }
@@ -399,50 +563,68 @@ thread_sleep(int64_t ticks) {
 	intr_set_level(old_level);
 }
 
+// 현재 스레드의 priority를 원래 값과 쥔 lock들로 받은 donation 중 큰 값으로 되돌린다.
 void 
 refresh_priority (void) {
-	thread_current()->priority = thread_current()->original_priority;
+	struct thread *curr = thread_current();
+	int old_priority = curr->priority;
+	enum intr_level old_level = intr_disable();
 
-	if (!list_empty(&thread_current()->donations)) {
-		struct thread *front_thread = list_entry (list_begin(&thread_current()->donations), struct thread, donations_elem);
-		if (thread_current()->priority < front_thread->priority) {
-			thread_current()->priority = front_thread->priority;
+	curr->priority = curr->original_priority;
+
+	if (!heap_empty(&curr->held_locks)) {
+		struct lock *top = heap_entry(heap_top(&curr->held_locks), struct lock, elem);
+		if (curr->priority < top->priority) {
+			curr->priority = top->priority;
 		}
 	}
+
+	// cond_wait() 중 lock_release()로 priority가 내려가면 condition 큐에서도 자리를 옮긴다.
+	if (curr->priority != old_priority) {
+		sema_requeue(curr);
+	}
+	intr_set_level(old_level);
 }
 
+// 현재 스레드가 기다리는 lock 사슬을 따라 priority를 기부한다.
 void 
 donate_priority(void) {
-    struct thread *curr = thread_current(); 
-    struct thread *holder;					
-
-    int priority = curr->priority;
+	struct thread *t = thread_current();
+	enum intr_level old_level = intr_disable();
 
-    for (int i = 0; i < 8; i++) {
-        if (curr->waiting_lock == NULL) {
-            return;
-		}
-        holder = curr->waiting_lock->holder;
-        holder->priority = priority;
-        curr = holder;
-    }
+	donate_lock_priority(t->waiting_lock, t->priority);
+	intr_set_level(old_level);
 }
+
+// LOCK부터 holder가 기다리는 lock 사슬을 따라 PRIORITY를 기부한다.
+// lock마다 받은 최고 priority를 기억하므로 더 올릴 것이 없는 곳에서 바로 멈춘다.
+// holder가 rwlock의 reader들을 기다리는 writer라면 reader마다 이어서 기부한다.
 void
-remove_with_lock (struct lock *lock) {
-   struct list_elem *curr_donation_elem = list_begin(&thread_current()->donations);
+donate_lock_priority(struct lock *lock, int priority) {
+	struct thread *t;
 
-   while (curr_donation_elem != list_tail(&thread_current()->donations)) {
-      struct thread *curr_donation_thread = list_entry(curr_donation_elem, struct thread, donations_elem);
-      
-      if (curr_donation_thread->waiting_lock == lock) {
-         curr_donation_elem = list_remove(curr_donation_elem);
-      }
-      else {
-         curr_donation_elem = list_next(curr_donation_elem);
-      }
-   }
-}
+	ASSERT(intr_get_level() == INTR_OFF);
 
+	for (; lock != NULL && lock->holder != NULL; lock = t->waiting_lock) {
+		if (priority <= lock->priority) {
+			break;
+		}
+		lock->priority = priority;
+		t = lock->holder;
+		heap_update(&t->held_locks, &lock->elem);
+
+		if (priority <= t->priority) {
+			break;
+		}
+		t->priority = priority;
+		// holder가 다른 lock을 기다리거나 ready 상태라면 그 큐에서 위치를 갱신
+		sema_requeue(t);
+		ready_requeue(t);
+		if (t->waiting_rwlock != NULL) {
+			rwlock_donate(t->waiting_rwlock, priority);
+		}
+	}
+}
 
 /* Sets the current thread's priority to NEW_PRIORITY. */
 void
@@ -473,7 +655,10 @@ thread_set_nice (int nice UNUSED) {
 	old_level = intr_disable();
 	t->nice = nice;
 
-	mlfqs_priority(t);
+	// CFS는 nice에서 바로 weight를 구하므로 따로 갱신할 것이 없다.
+	if (thread_mlfqs) {
+		mlfqs_priority(t);
+	}
 	test_max_priority();
 	intr_set_level(old_level);
 }
@@ -522,15 +707,46 @@ void mlfqs_priority (struct thread *t) {
 		int div_cpu = fp_to_int(div_mixed(t->recent_cpu, 4));
 		int mult_nice = t->nice * 2;
 		t->priority = PRI_MAX - div_cpu - mult_nice;
+		if (t->priority > PRI_MAX) {
+			t->priority = PRI_MAX;
+		} else if (t->priority < PRI_MIN) {
+			t->priority = PRI_MIN;
+		}
 	}
 }	
 
+// recent_cpu를 지금(mlfqs_epoch)까지 밀린 만큼 decay한다.
 void mlfqs_recent_cpu (struct thread *t) {
-	if (t != idle_thread) {
-		int mult_load = mult_mixed(load_avg, 2);
-		int mult_load_add = add_mixed(mult_load, 1);
-		int temp = mult_fp(div_fp(mult_load, mult_load_add), t->recent_cpu);
-		t->recent_cpu = add_mixed(temp, t->nice);
+	int64_t epoch = t->cpu_epoch;
+
+	t->cpu_epoch = mlfqs_epoch;
+	if (t == idle_thread) {
+		return;
+	}
+
+	// 기록보다 오래 쉰 스레드: 가장 오래된 계수를 남은 초만큼 한 번에 적용한다.
+	// c^k * recent_cpu + nice * (1 - c^k) / (1 - c)
+	if (mlfqs_epoch - epoch > DECAY_HISTORY) {
+		int64_t k = mlfqs_epoch - DECAY_HISTORY - epoch;
+		int c = decay_coef[mlfqs_epoch % DECAY_HISTORY];
+		int ck = int_to_fp(1);
+		int base = c;
+
+		for (; k > 0; k >>= 1) {
+			if (k & 1) {
+				ck = mult_fp(ck, base);
+			}
+			base = mult_fp(base, base);
+		}
+		t->recent_cpu = add_fp(mult_fp(ck, t->recent_cpu),
+		                       div_fp(mult_mixed(sub_fp(int_to_fp(1), ck), t->nice),
+		                              sub_fp(int_to_fp(1), c)));
+		epoch = mlfqs_epoch - DECAY_HISTORY;
+	}
+
+	for (; epoch < mlfqs_epoch; epoch++) {
+		int coef = decay_coef[epoch % DECAY_HISTORY];
+		t->recent_cpu = add_mixed(mult_fp(coef, t->recent_cpu), t->nice);
 	}
 }
 
@@ -538,7 +754,7 @@ void mlfqs_recent_cpu (struct thread *t) {
 void mlfqs_load_avg (void) {
 	int a = div_fp(int_to_fp(59), int_to_fp(60));
 	int mult_load = mult_fp(a, load_avg);
-	int ready_threads = list_size(&ready_list);
+	int ready_threads = ready_cnt;
 	if (thread_current() != idle_thread) {
     	ready_threads++;
 	}
@@ -548,36 +764,303 @@ void mlfqs_load_avg (void) {
 }
 
 void mlfqs_increment (void) {
-	if (thread_current != idle_thread) {
+	if (thread_current() != idle_thread) {
 		thread_current()->recent_cpu = add_mixed(thread_current()->recent_cpu, 1);
 	}
 }
 
+// 1초마다: 이번 초의 decay 계수를 기록하고, 실행 중인 스레드와 ready 스레드만
+// 바로 갱신한다. 잠든/블록된 스레드는 깨어날 때 thread_unblock()에서 따라잡는다.
 void mlfqs_recalc (void) {
 	struct thread *t;
 	struct list_elem *e;
 
-	for (e = list_begin(&ready_list); e != list_end(&ready_list); e = list_next(e)) {
-		t = list_entry(e, struct thread, elem);
-		if (t != NULL) {
+	int mult_load = mult_mixed(load_avg, 2);
+	int mult_load_add = add_mixed(mult_load, 1);
+	decay_coef[mlfqs_epoch % DECAY_HISTORY] = div_fp(mult_load, mult_load_add);
+	mlfqs_epoch++;
+
+	// priority가 바뀐 스레드는 새 priority의 큐 뒤로 O(1)에 옮긴다.
+	// 아직 안 본 큐로 옮겨진 스레드를 다시 만나도 epoch이 같아 그대로 남는다.
+	for (int p = PRI_MAX; p >= PRI_MIN; p--) {
+		struct list *q = &ready_queues[p];
+
+		for (e = list_begin(q); e != list_end(q);) {
+			t = list_entry(e, struct thread, elem);
 			mlfqs_recent_cpu(t);
 			mlfqs_priority(t);
+			if (t->priority != p) {
+				e = list_remove(e);
+				list_push_back(&ready_queues[t->priority], &t->elem);
+				ready_mask |= 1ULL << t->priority;
+			} else {
+				e = list_next(e);
+			}
 		}
 	}
 
-	for (e = list_begin(&sleep_list); e != list_end(&sleep_list); e = list_next(e)) {
-        t = list_entry(e, struct thread, elem);
-		if (t != NULL) {
-        	mlfqs_recent_cpu(t);
-        	mlfqs_priority(t);
+	t = thread_current();
+	mlfqs_recent_cpu(t);
+	mlfqs_priority(t);
+}
+
+/* Adds ready thread T to the run queue of the active scheduler. */
+static void
+ready_push (struct thread *t) {
+	if (t->dl_runtime > 0) {
+		if (t->dl_throttled) {
+			list_insert_ordered (&dl_throttled, &t->elem, dl_period_less, NULL);
+			return;
 		}
-    }
+		heap_insert (&dl_queue, &t->dl_elem);
+	} else if (thread_cfs) {
+		heap_insert (&cfs_queue, &t->cfs_elem);
+		cfs_load += cfs_weight (t);
+	} else {
+		list_push_back (&ready_queues[t->priority], &t->elem);
+		ready_mask |= 1ULL << t->priority;
+	}
+	ready_cnt++;
+}
 
-	t = thread_current();
-	if (t != NULL) {
-   		mlfqs_recent_cpu(t);
-    	mlfqs_priority(t);
+/* Moves ready thread T to the run queue of its priority after the
+   priority was raised.  The other run queues do not order by
+   priority. */
+static void
+ready_requeue (struct thread *t) {
+	if (t->status != THREAD_READY || thread_cfs || t->dl_runtime > 0)
+		return;
+	list_remove (&t->elem);
+	list_push_back (&ready_queues[t->priority], &t->elem);
+	ready_mask |= 1ULL << t->priority;
+}
+
+/* Returns the highest priority with a ready thread in
+   ready_queues, or PRI_MIN - 1 if there is none. */
+static int
+ready_top_priority (void) {
+	while (ready_mask != 0) {
+		int p = 63 - __builtin_clzll (ready_mask);
+
+		if (!list_empty (&ready_queues[p]))
+			return p;
+		ready_mask &= ~(1ULL << p);
 	}
+	return PRI_MIN - 1;
+}
+
+/* Removes and returns the thread that should run next, or a null
+   pointer if no thread is ready. */
+static struct thread *
+ready_pop (void) {
+	struct thread *t;
+
+	if (ready_cnt == 0)
+		return NULL;
+	if (!heap_empty (&dl_queue))
+		t = heap_entry (heap_pop (&dl_queue), struct thread, dl_elem);
+	else if (thread_cfs) {
+		t = heap_entry (heap_pop (&cfs_queue), struct thread, cfs_elem);
+		cfs_load -= cfs_weight (t);
+	} else
+		t = list_entry (list_pop_front (&ready_queues[ready_top_priority ()]),
+				struct thread, elem);
+	ready_cnt--;
+	return t;
+}
+
+/* Orders cfs_queue so that its top has the least vruntime; ties
+   go to the thread that became ready first. */
+static bool
+cfs_less (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = heap_entry (a_, struct thread, cfs_elem);
+	const struct thread *b = heap_entry (b_, struct thread, cfs_elem);
+
+	return a->vruntime > b->vruntime;
+}
+
+/* Returns the CFS weight of T's nice value. */
+static int
+cfs_weight (const struct thread *t) {
+	int nice = t->nice;
+
+	if (nice < NICE_MIN)
+		nice = NICE_MIN;
+	else if (nice > NICE_MAX)
+		nice = NICE_MAX;
+	return nice_to_weight[nice - NICE_MIN];
+}
+
+/* Returns the length of running thread T's slice in ticks: its
+   weight's share of a period that is CFS_LATENCY long, or longer
+   if there are too many ready threads for each to get
+   CFS_MIN_GRANULARITY. */
+static unsigned
+cfs_slice (const struct thread *t) {
+	unsigned long load = cfs_load + cfs_weight (t);
+	unsigned period = CFS_LATENCY;
+	unsigned slice;
+
+	if ((unsigned) (ready_cnt + 1) * CFS_MIN_GRANULARITY > period)
+		period = (ready_cnt + 1) * CFS_MIN_GRANULARITY;
+	slice = period * cfs_weight (t) / load;
+	return slice > CFS_MIN_GRANULARITY ? slice : CFS_MIN_GRANULARITY;
+}
+
+/* Charges running thread T for one tick and advances
+   min_vruntime. */
+static void
+cfs_charge (struct thread *t) {
+	uint64_t floor;
+
+	t->vruntime += (uint64_t) TICK_VRUNTIME * NICE0_WEIGHT / cfs_weight (t);
+
+	floor = t->vruntime;
+	if (!heap_empty (&cfs_queue)) {
+		struct thread *next = heap_entry (heap_top (&cfs_queue),
+				struct thread, cfs_elem);
+		if (next->vruntime < floor)
+			floor = next->vruntime;
+	}
+	if (floor > min_vruntime)
+		min_vruntime = floor;
+}
+
+/* Orders dl_queue so that its top has the earliest absolute
+   deadline. */
+static bool
+dl_less (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = heap_entry (a_, struct thread, dl_elem);
+	const struct thread *b = heap_entry (b_, struct thread, dl_elem);
+
+	return a->dl_abs_deadline > b->dl_abs_deadline;
+}
+
+/* Returns the tick at which RT thread T's next period begins. */
+static int64_t
+dl_next_period (const struct thread *t) {
+	return t->dl_abs_deadline - t->dl_deadline + t->dl_period;
+}
+
+/* Orders dl_throttled by the start of each thread's next
+   period. */
+static bool
+dl_period_less (const struct list_elem *a_, const struct list_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = list_entry (a_, struct thread, elem);
+	const struct thread *b = list_entry (b_, struct thread, elem);
+
+	return dl_next_period (a) < dl_next_period (b);
+}
+
+/* Returns true if ready RT thread T should preempt the running
+   thread. */
+static bool
+dl_preempts (const struct thread *t) {
+	const struct thread *curr = thread_current ();
+
+	return curr == idle_thread || curr->dl_runtime == 0
+		|| t->dl_abs_deadline < curr->dl_abs_deadline;
+}
+
+/* Gives RT thread T, which is waking up, a new deadline and a full
+   budget if its old deadline has passed or if running out its
+   remaining budget before that deadline would exceed its reserved
+   bandwidth. */
+static void
+dl_wakeup (struct thread *t) {
+	int64_t now = timer_ticks ();
+
+	if (t->dl_abs_deadline <= now
+			|| t->dl_budget * t->dl_period
+			   > t->dl_runtime * (t->dl_abs_deadline - now)) {
+		t->dl_abs_deadline = now + t->dl_deadline;
+		t->dl_budget = t->dl_runtime;
+	}
+}
+
+/* Moves each throttled RT thread whose next period has begun back
+   to dl_queue with a full budget.  Called from the timer
+   interrupt. */
+static void
+dl_replenish (void) {
+	int64_t now = timer_ticks ();
+
+	while (!list_empty (&dl_throttled)) {
+		struct thread *t = list_entry (list_front (&dl_throttled),
+				struct thread, elem);
+
+		if (dl_next_period (t) > now)
+			break;
+		list_pop_front (&dl_throttled);
+		t->dl_abs_deadline += t->dl_period;
+		t->dl_budget = t->dl_runtime;
+		t->dl_throttled = false;
+		ready_push (t);
+		if (dl_preempts (t))
+			intr_yield_on_return ();
+	}
+}
+
+/* Returns RUNTIME / PERIOD as a DL_BW_SHIFT-bit fraction. */
+static uint64_t
+dl_bw (int64_t runtime, int64_t period) {
+	return runtime > 0 ? ((uint64_t) runtime << DL_BW_SHIFT) / period : 0;
+}
+
+/* Makes the running thread a real-time thread that runs for
+   RUNTIME ticks in every PERIOD ticks, each time finishing within
+   DEADLINE ticks of the start of the period.  A RUNTIME of 0
+   makes it an ordinary thread again.  Returns false, changing
+   nothing, if the parameters are inconsistent or if admitting
+   the thread would reserve more than DL_BW_LIMIT of the CPU. */
+bool
+thread_set_deadline (int64_t runtime, int64_t deadline, int64_t period) {
+	struct thread *curr = thread_current ();
+	uint64_t old_bw, new_bw;
+	enum intr_level old_level;
+
+	if (runtime < 0 || (runtime > 0 && (deadline < runtime || period < deadline)))
+		return false;
+
+	old_level = intr_disable ();
+	old_bw = dl_bw (curr->dl_runtime, curr->dl_period);
+	new_bw = dl_bw (runtime, period);
+	if (dl_total_bw - old_bw + new_bw > DL_BW_LIMIT) {
+		intr_set_level (old_level);
+		return false;
+	}
+	dl_total_bw = dl_total_bw - old_bw + new_bw;
+
+	curr->dl_runtime = runtime;
+	curr->dl_deadline = deadline;
+	curr->dl_period = period;
+	curr->dl_abs_deadline = timer_ticks () + deadline;
+	curr->dl_budget = runtime;
+	curr->dl_throttled = false;
+	intr_set_level (old_level);
+
+	/* Leaving the class may let a waiting RT thread run. */
+	if (!intr_context ())
+		test_max_priority ();
+	return true;
+}
+
+/* Returns the tick by which the idle CPU must be awake: the
+   earliest sleeper's alarm or throttled RT thread's next period. */
+static int64_t
+idle_next_event (void) {
+	int64_t next = MIN_alarm_time;
+
+	if (!list_empty (&dl_throttled)) {
+		struct thread *t = list_entry (list_front (&dl_throttled),
+				struct thread, elem);
+		if (dl_next_period (t) < next)
+			next = dl_next_period (t);
+	}
+	return next;
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -599,8 +1082,13 @@ idle (void *idle_started_ UNUSED) {
 	for (;;) {
 		/* Let someone else run. */
 		intr_disable ();
+		timer_idle_exit ();
 		thread_block ();
 
+		/* Nothing is runnable: let the timer sleep until the next
+		   wakeup is due instead of ticking. */
+		timer_idle_enter (idle_next_event ());
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -632,6 +1120,8 @@ kernel_thread (thread_func *function, void *aux) {
    NAME. */
 static void
 init_thread (struct thread *t, const char *name, int priority) {
+	enum intr_level old_level;
+
 	ASSERT (t != NULL);
 	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
 	ASSERT (name != NULL);
@@ -646,11 +1136,21 @@ init_thread (struct thread *t, const char *name, int priority) {
 	/* inversion */
 	t->original_priority = priority;
 	t->waiting_lock = NULL;
-	list_init(&t->donations);
+	t->waiting_rwlock = NULL;
+	heap_init(&t->held_locks, lock_priority_less, NULL);
 
 	/* MLFQS*/
 	t->nice = NICE_DEFAULT;
 	t->recent_cpu = RECENT_CPU_DEFAULT;
+	t->cpu_epoch = mlfqs_epoch;
+
+	/* CFS: 새 스레드는 0이 아니라 지금의 min_vruntime에서 시작해야
+	   오래 돈 스레드들을 한참 밀어내지 않는다. */
+	t->vruntime = min_vruntime;
+
+	old_level = intr_disable ();
+	list_push_back (&all_list, &t->allelem);
+	intr_set_level (old_level);
 
 	/* process */
 	list_init(&t->child_list);
@@ -678,10 +1178,8 @@ init_thread (struct thread *t, const char *name, int priority) {
    idle_thread. */
 static struct thread *
 next_thread_to_run (void) {
-	if (list_empty (&ready_list))
-		return idle_thread;
-	else
-		return list_entry (list_pop_front (&ready_list), struct thread, elem);
+	struct thread *next = ready_pop ();
+	return next != NULL ? next : idle_thread;
 }
 
 /* Use iretq to launch the thread */
@@ -0,0 +1,193 @@
+/* fdtable.c: Per-process file descriptor table.
+ *
+ * Most processes keep a handful of files open, so the first FD_INLINE
+ * descriptors are stored in struct thread and cost nothing extra.
+ * Past those, the table grows into a two-level structure: a directory
+ * of FD_CHUNKS pointers to chunks of FD_CHUNK descriptors, both
+ * allocated on demand.  A used-bit mask per level finds the lowest
+ * free descriptor in constant time. */
+
+#include "userprog/fdtable.h"
+
+#include <debug.h>
+#include <string.h>
+
+#include "filesys/file.h"
+#include "threads/malloc.h"
+
+#define INLINE_FULL ((uint8_t)((1u << FD_INLINE) - 1))
+#define CHUNKS_FULL ((uint32_t)((1ull << FD_CHUNKS) - 1))
+#define CHUNK_FULL UINT64_MAX
+
+/* Returns the slot of descriptor FD, or NULL if its chunk has not been
+ * allocated.  FD must be in range. */
+static struct file **fd_slot(struct fd_table *fdt, int fd) {
+    struct fd_chunk *chunk;
+
+    if (fd < FD_INLINE) {
+        return &fdt->files[fd];
+    }
+    fd -= FD_INLINE;
+    if (fdt->chunks == NULL ||
+        (chunk = fdt->chunks[fd / FD_CHUNK]) == NULL) {
+        return NULL;
+    }
+    return &chunk->files[fd % FD_CHUNK];
+}
+
+/* Put FILE in descriptor FD, which must be free, allocating its chunk
+ * if needed.  Returns false if memory runs out. */
+static bool fd_install(struct fd_table *fdt, int fd, struct file *file) {
+    struct fd_chunk *chunk;
+    int c, i;
+
+    if (fd < FD_INLINE) {
+        fdt->files[fd] = file;
+        fdt->used |= 1u << fd;
+        return true;
+    }
+
+    c = (fd - FD_INLINE) / FD_CHUNK;
+    i = (fd - FD_INLINE) % FD_CHUNK;
+    if (fdt->chunks == NULL) {
+        fdt->chunks = calloc(FD_CHUNKS, sizeof *fdt->chunks);
+        if (fdt->chunks == NULL) {
+            return false;
+        }
+    }
+    chunk = fdt->chunks[c];
+    if (chunk == NULL) {
+        chunk = fdt->chunks[c] = calloc(1, sizeof *chunk);
+        if (chunk == NULL) {
+            return false;
+        }
+    }
+    chunk->files[i] = file;
+    chunk->used |= 1ull << i;
+    if (chunk->used == CHUNK_FULL) {
+        fdt->full |= 1u << c;
+    }
+    return true;
+}
+
+/* Set up FDT with only the console descriptors open. */
+void fd_table_init(struct fd_table *fdt) {
+    memset(fdt, 0, sizeof *fdt);
+    fd_install(fdt, 0, FD_STDIN);
+    fd_install(fdt, 1, FD_STDOUT);
+}
+
+/* Give FILE the lowest free descriptor and return it, or -1 if the
+ * table is full. */
+int fd_table_add(struct fd_table *fdt, struct file *file) {
+    int fd, c;
+
+    if (fdt->used != INLINE_FULL) {
+        fd = __builtin_ctz(~fdt->used & INLINE_FULL);
+    } else if (fdt->full != CHUNKS_FULL) {
+        c = __builtin_ctz(~fdt->full & CHUNKS_FULL);
+        fd = FD_INLINE + c * FD_CHUNK;
+        // 아직 없는 chunk라면 첫 칸이 비어 있다.
+        if (fdt->chunks != NULL && fdt->chunks[c] != NULL) {
+            fd += __builtin_ctzll(~fdt->chunks[c]->used);
+        }
+    } else {
+        return -1;
+    }
+    return fd_install(fdt, fd, file) ? fd : -1;
+}
+
+/* Returns the file open as descriptor FD, or NULL if there is none. */
+struct file *fd_table_get(struct fd_table *fdt, int fd) {
+    struct file **slot;
+
+    if (fd < 0 || fd >= FDCOUNT_LIMIT || (slot = fd_slot(fdt, fd)) == NULL) {
+        return NULL;
+    }
+    return *slot;
+}
+
+/* Free descriptor FD and return the file it held, or NULL if it was
+ * not open. */
+struct file *fd_table_remove(struct fd_table *fdt, int fd) {
+    struct file **slot;
+    struct file *file;
+
+    if (fd < 0 || fd >= FDCOUNT_LIMIT || (slot = fd_slot(fdt, fd)) == NULL ||
+        *slot == NULL) {
+        return NULL;
+    }
+    file = *slot;
+    *slot = NULL;
+    if (fd < FD_INLINE) {
+        fdt->used &= ~(1u << fd);
+    } else {
+        int c = (fd - FD_INLINE) / FD_CHUNK;
+        fdt->chunks[c]->used &= ~(1ull << ((fd - FD_INLINE) % FD_CHUNK));
+        fdt->full &= ~(1u << c);
+    }
+    return file;
+}
+
+/* Make DST, freshly initialized, a copy of SRC for a forked child:
+ * every open file is duplicated, console descriptors are shared.
+ * Only the chunks SRC has allocated are visited.  Returns false if
+ * memory runs out; DST may then hold some of the files. */
+bool fd_table_copy(struct fd_table *dst, struct fd_table *src) {
+    int fd;
+
+    for (fd = 0; fd < FDCOUNT_LIMIT; fd++) {
+        struct file **slot = fd_slot(src, fd);
+        struct file *file;
+
+        if (slot == NULL) {
+            // 없는 chunk는 통째로 건너뛴다.
+            fd += FD_CHUNK - 1 - (fd - FD_INLINE) % FD_CHUNK;
+            continue;
+        }
+        if (*slot == NULL) {
+            continue;
+        }
+        file = *slot;
+        if (file != FD_STDIN && file != FD_STDOUT) {
+            file = file_duplicate(file);
+            if (file == NULL) {
+                return false;
+            }
+        }
+        // init이 0, 1번을 이미 채웠을 수 있다.
+        fd_table_remove(dst, fd);
+        if (!fd_install(dst, fd, file)) {
+            if (file != FD_STDIN && file != FD_STDOUT) {
+                file_close(file);
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Close every file in FDT and free its chunks. */
+void fd_table_destroy(struct fd_table *fdt) {
+    int fd;
+
+    for (fd = 0; fd < FDCOUNT_LIMIT; fd++) {
+        struct file **slot = fd_slot(fdt, fd);
+
+        if (slot == NULL) {
+            fd += FD_CHUNK - 1 - (fd - FD_INLINE) % FD_CHUNK;
+            continue;
+        }
+        if (*slot != NULL && *slot != FD_STDIN && *slot != FD_STDOUT) {
+            file_close(*slot);
+        }
+        *slot = NULL;
+    }
+    if (fdt->chunks != NULL) {
+        for (int c = 0; c < FD_CHUNKS; c++) {
+            free(fdt->chunks[c]);
+        }
+        free(fdt->chunks);
+    }
+    memset(fdt, 0, sizeof *fdt);
+}
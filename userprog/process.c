@@ -29,8 +29,6 @@ static bool load(const char *file_name, struct intr_frame *if_);
 static void initd(void *f_name);
 static void __do_fork(void *);
 
-extern struct lock file_lock;
-
 /* General process initializer for initd and other process. */
 static void process_init(void) { struct thread *current = thread_current(); }
 
@@ -158,6 +156,12 @@ static void __do_fork(void *aux) {
     process_activate(current);
 #ifdef VM
     supplemental_page_table_init(&current->spt);
+    current->rss_limit = parent->rss_limit;
+    current->oom_adj = parent->oom_adj;
+    current->heap_start = parent->heap_start;
+    current->heap_brk = parent->heap_brk;
+    current->mmap_hint = parent->mmap_hint;
+    current->stack_bottom = parent->stack_bottom;
     if (!supplemental_page_table_copy(&current->spt, &parent->spt)) goto error;
 #else
     if (!pml4_for_each(parent->pml4, duplicate_pte, parent)) goto error;
@@ -168,19 +172,9 @@ static void __do_fork(void *aux) {
      * TODO:       in include/filesys/file.h. Note that parent should not return
      * TODO:       from the fork() until this function successfully duplicates
      * TODO:       the resources of parent.*/
-    if (parent->fd_idx == FDCOUNT_LIMIT) {
+    if (!fd_table_copy(&current->fds, &parent->fds)) {
         goto error;
     }
-
-    for (int i = 0; i < FDCOUNT_LIMIT; i++) {
-        struct file *file = parent->fd_table[i];
-        if (file == NULL) continue;
-        if (file > 2) {
-            file = file_duplicate(file);
-        }
-        current->fd_table[i] = file;
-    }
-    current->fd_idx = parent->fd_idx;
     sema_up(&current->fork_sema);
 
     // process_init ();
@@ -208,6 +202,9 @@ int process_exec(void *f_name) {
     _if.eflags = FLAG_IF | FLAG_MBS;
 
     /* We first kill the current context */
+#ifdef VM
+    vm_file_flush(thread_current());
+#endif
     process_cleanup();
     supplemental_page_table_init(&thread_current()->spt);
 
@@ -218,9 +215,7 @@ int process_exec(void *f_name) {
     /* project 2: argument passing */
 
     /* And then load the binary */
-    lock_acquire(&file_lock);
     success = load(file_name, &_if);
-    lock_release(&file_lock);
 
     /* If load failed, quit. */
     if (!success) {
@@ -276,16 +271,20 @@ void process_exit(void) {
      * TODO: Implement process termination message (see
      * TODO: project2/process_termination.html).
      * TODO: We recommend you to implement process resource cleanup here. */
-    for (int i = 2; i < curr->fd_idx; i++) {
-        close(i);
-    }
-    palloc_free_multiple(curr->fd_table, FDT_PAGES);
+    fd_table_destroy(&curr->fds);
 
     file_close(curr->running);
 
+#ifdef VM
+    // 부모가 wait에서 돌아왔을 때 mmap한 내용은 이미 파일에 있어야 한다.
+    vm_file_flush(curr);
+#endif
+    /* The parent needs nothing more from us than the exit status, so
+     * let its wait() return before tearing down the address space. */
+    sema_up(&curr->wait_sema);
+
     process_cleanup();
 
-    sema_up(&curr->wait_sema);
     sema_down(&curr->exit_sema);
 }
 
@@ -388,7 +387,6 @@ static bool load_segment(struct file *file, off_t ofs, uint8_t *upage,
  * Stores the executable's entry point into *RIP
  * and its initial stack pointer into *RSP.
  * Returns true if successful, false otherwise. */
-//extern struct lock file_lock;
 static bool load(const char *file_name, struct intr_frame *if_) {
     struct thread *t = thread_current();
     struct ELF ehdr;
@@ -401,11 +399,12 @@ static bool load(const char *file_name, struct intr_frame *if_) {
     t->pml4 = pml4_create();
     if (t->pml4 == NULL) goto done;
     process_activate(thread_current());
+#ifdef VM
+    t->heap_start = t->heap_brk = NULL;
+#endif
 
     /* Open executable file. */
-    //lock_acquire(&file_lock);
     file = filesys_open(file_name);
-    //lock_release(&file_lock);
     if (file == NULL) {
         printf("load: %s: open failed\n", file_name);
         goto done;
@@ -470,6 +469,14 @@ static bool load(const char *file_name, struct intr_frame *if_) {
                     if (!load_segment(file, file_page, (void *)mem_page,
                                       read_bytes, zero_bytes, writable))
                         goto done;
+#ifdef VM
+                    // heap은 가장 높은 세그먼트 바로 위 페이지에서 시작한다.
+                    if (pg_round_up(phdr.p_vaddr + phdr.p_memsz) >
+                        t->heap_start) {
+                        t->heap_start =
+                            pg_round_up(phdr.p_vaddr + phdr.p_memsz);
+                    }
+#endif
                 } else
                     goto done;
                 break;
@@ -478,6 +485,10 @@ static bool load(const char *file_name, struct intr_frame *if_) {
 
     /* Set up stack. */
     if (!setup_stack(if_)) goto done;
+#ifdef VM
+    t->heap_brk = t->heap_start;
+    t->mmap_hint = (void *)STACK_GUARD;
+#endif
 
     /* Start address. */
     if_->rip = ehdr.e_entry;
@@ -721,6 +732,7 @@ static bool setup_stack(struct intr_frame *if_) {
     /* TODO: Your code goes here */
     if (vm_alloc_page(VM_ANON | VM_MARKER_0, stack_bottom, true)) {
         if (vm_claim_page(stack_bottom)) {
+            thread_current()->stack_bottom = stack_bottom;
             if_->rsp = USER_STACK;
             success = true;
         }
@@ -1,9 +1,11 @@
 #include "userprog/syscall.h"
 
+#include <clock.h>
 #include <stdio.h>
 #include <syscall-nr.h>
 
 #include "devices/input.h"
+#include "devices/timer.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
@@ -24,9 +26,16 @@
 void syscall_entry(void);
 void syscall_handler(struct intr_frame *);
 struct file *get_file_from_fd_table(int fd);
-struct lock file_lock;
 void *mmap(void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap(void *addr);
+int madvise(void *addr, size_t length, int advice);
+int msync(void *addr, size_t length);
+size_t memlimit(size_t pages);
+int oom_adjust(int adj);
+void *sbrk(intptr_t increment);
+int vmstat(struct vmstat *st);
+int sched_deadline(unsigned runtime, unsigned deadline, unsigned period);
+int clock_gettime(int clock, struct timespec *ts);
 /* System call.
  *
  * Previously system call services was handled by the interrupt handler
@@ -50,8 +59,6 @@ void syscall_init(void) {
      * mode stack. Therefore, we masked the FLAG_FL. */
     write_msr(MSR_SYSCALL_MASK,
               FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
-
-    lock_init(&file_lock);
 }
 
 struct page *check_address(void *addr) {
@@ -61,25 +68,16 @@ struct page *check_address(void *addr) {
 }
 
 int add_file_to_fd_table(struct file *file) {
-    struct thread *curr = thread_current();
-    struct file **fdt = curr->fd_table;
-
-    while (curr->fd_idx < FDCOUNT_LIMIT && fdt[curr->fd_idx]) {
-        curr->fd_idx++;
-    }
-
-    if (curr->fd_idx == FDCOUNT_LIMIT) {
-        return -1;
-    }
-
-    fdt[curr->fd_idx] = file;
-
-    return curr->fd_idx;
+    return fd_table_add(&thread_current()->fds, file);
 }
 
 void halt(void) { power_off(); }
 
 void exit(int status) {
+    // OOM killer에게 죽은 프로세스는 어디서 끝나든 같은 상태로 보고한다.
+    if (thread_current()->oom_killed) {
+        status = OOM_EXIT_STATUS;
+    }
     thread_current()->exit_status = status;
     printf("%s: exit(%d)\n", thread_name(), thread_current()->exit_status);
     thread_exit();
@@ -101,12 +99,7 @@ int wait(tid_t tid) { return process_wait(tid); }
 
 bool create(const char *file, unsigned initial_size) {
     check_address(file);
-
-    lock_acquire(&file_lock);
-    bool success = filesys_create(file, initial_size);
-    lock_release(&file_lock);
-
-    return success;
+    return filesys_create(file, initial_size);
 }
 
 bool remove(const char *file) {
@@ -116,9 +109,7 @@ bool remove(const char *file) {
 
 int open(const char *file) {
     check_address(file);
-    lock_acquire(&file_lock);
     struct file *file_info = filesys_open(file);
-    lock_release(&file_lock);
     if (file_info == NULL) {
         return -1;
     }
@@ -149,19 +140,19 @@ int read(int fd, void *buffer, unsigned length) {
         if (f == NULL) {
             return -1;
         }
-        lock_acquire(&file_lock);
+        // 버퍼 프레임을 미리 올려 고정해 두면 inode 락을 쥔 채 fault가
+        // 나지 않는다.
+        if (!vm_pin_range(buffer, length, true)) {
+            exit(-1);
+        }
         bytesRead = file_read(f, buffer, length);
-        lock_release(&file_lock);
+        vm_unpin_range(buffer, length);
     }
     return bytesRead;
 }
 
 struct file *get_file_from_fd_table(int fd) {
-    struct thread *t = thread_current();
-    if (fd < 0 || fd >= 128) {
-        return NULL;
-    }
-    return t->fd_table[fd];
+    return fd_table_get(&thread_current()->fds, fd);
 }
 
 void validate_buffer(void *buffer, size_t size, bool to_write) {
@@ -200,9 +191,11 @@ int write(int fd, const void *buffer, unsigned length) {
         if (f == NULL) {
             return -1;
         }
-        lock_acquire(&file_lock);
+        if (!vm_pin_range(buffer, length, false)) {
+            exit(-1);
+        }
         bytesRead = file_write(f, buffer, length);
-        lock_release(&file_lock);
+        vm_unpin_range(buffer, length);
     }
     return bytesRead;
 }
@@ -224,21 +217,19 @@ unsigned tell(int fd) {
 }
 
 void close(int fd) {
-    struct thread *t = thread_current();
-    struct file **fdt = t->fd_table;
-    if (fd < 0 || fd >= 128) {
+    struct file *file = fd_table_remove(&thread_current()->fds, fd);
+    if (file == NULL || file == FD_STDIN || file == FD_STDOUT) {
         return;
     }
-    if (fdt[fd] == NULL) {
-        return;
-    }
-    file_close(fdt[fd]);
-    fdt[fd] = NULL;
+    file_close(file);
 }
 
 /* The main system call interface */
 void syscall_handler(struct intr_frame *f) {
     thread_current()->user_rsp = f->rsp;
+    if (thread_current()->oom_killed) {
+        exit(OOM_EXIT_STATUS);
+    }
 
     switch (f->R.rax) {
         case SYS_HALT:
@@ -291,6 +282,30 @@ void syscall_handler(struct intr_frame *f) {
         case SYS_MUNMAP:
             munmap(f->R.rdi);
             break;
+        case SYS_MADVISE:
+            f->R.rax = madvise((void *)f->R.rdi, f->R.rsi, f->R.rdx);
+            break;
+        case SYS_MSYNC:
+            f->R.rax = msync((void *)f->R.rdi, f->R.rsi);
+            break;
+        case SYS_MEMLIMIT:
+            f->R.rax = memlimit(f->R.rdi);
+            break;
+        case SYS_OOM_ADJUST:
+            f->R.rax = oom_adjust(f->R.rdi);
+            break;
+        case SYS_SBRK:
+            f->R.rax = (uint64_t)sbrk(f->R.rdi);
+            break;
+        case SYS_VMSTAT:
+            f->R.rax = vmstat((struct vmstat *)f->R.rdi);
+            break;
+        case SYS_SCHED_DEADLINE:
+            f->R.rax = sched_deadline(f->R.rdi, f->R.rsi, f->R.rdx);
+            break;
+        case SYS_CLOCK_GETTIME:
+            f->R.rax = clock_gettime(f->R.rdi, (struct timespec *)f->R.rsi);
+            break;
         default:
             exit(-1);
     }
@@ -299,6 +314,14 @@ void munmap(void *addr) { do_munmap(addr); }
 
 void *mmap(void *addr, size_t length, int writable, int fd, off_t offset) {
     struct thread *t = thread_current();
+    // fd -1: 파일 없이 0으로 채운 익명 매핑. addr가 NULL이면 커널이 고른다.
+    if (fd == -1) {
+        if (pg_round_down(addr) != addr || is_kernel_vaddr(addr) ||
+            (long long)length <= 0 || offset != 0) {
+            return NULL;
+        }
+        return do_anon_mmap(addr, length, writable);
+    }
     // 파일의 시작점(offset)이 page-align되지 않았을 때
     if (offset % PGSIZE != 0) {
         return NULL;
@@ -310,6 +333,10 @@ void *mmap(void *addr, size_t length, int writable, int fd, off_t offset) {
         (long long)length <= 0) {
         return NULL;
     }
+    // 스택 영역과 그 아래 guard 페이지에는 매핑할 수 없다.
+    if (addr + length < addr || vm_overlaps_stack(addr, length)) {
+        return NULL;
+    }
     // 매핑하려는 페이지가 이미 존재하는 페이지와 겹칠 때(==SPT에 존재하는
     // 페이지일 때)
 
@@ -329,4 +356,85 @@ void *mmap(void *addr, size_t length, int writable, int fd, off_t offset) {
     }
 
     return do_mmap(addr, length, writable, f, offset);
-}
\ No newline at end of file
+}
+
+int madvise(void *addr, size_t length, int advice) {
+    // 범위가 page-align된 유저 영역이어야 한다.
+    if (addr == NULL || pg_round_down(addr) != addr || length == 0 ||
+        addr + length < addr || is_kernel_vaddr(addr) ||
+        is_kernel_vaddr(addr + length - 1)) {
+        return -1;
+    }
+    if (advice < MADV_NORMAL || advice > MADV_DONTNEED) {
+        return -1;
+    }
+
+    return vm_madvise(addr, length, advice);
+}
+
+int msync(void *addr, size_t length) {
+    if (addr == NULL || pg_round_down(addr) != addr || length == 0 ||
+        addr + length < addr || is_kernel_vaddr(addr) ||
+        is_kernel_vaddr(addr + length - 1)) {
+        return -1;
+    }
+
+    return do_msync(addr, length);
+}
+
+/* Limit the calling process to PAGES resident frames (0 lifts the
+ * limit) and return the previous limit.  Children inherit it. */
+size_t memlimit(size_t pages) {
+    struct thread *curr = thread_current();
+    size_t old = curr->rss_limit;
+
+    curr->rss_limit = pages;
+    return old;
+}
+
+/* Set the calling process's OOM score adjustment, clamped to
+ * [OOM_ADJ_MIN, OOM_ADJ_MAX], and return the previous one.  The OOM
+ * killer scales a process's resident plus swapped pages by
+ * (1000 + ADJ) / 1000; OOM_ADJ_MIN exempts it.  Children inherit it. */
+int oom_adjust(int adj) {
+    struct thread *curr = thread_current();
+    int old = curr->oom_adj;
+
+    if (adj < OOM_ADJ_MIN) {
+        adj = OOM_ADJ_MIN;
+    } else if (adj > OOM_ADJ_MAX) {
+        adj = OOM_ADJ_MAX;
+    }
+    curr->oom_adj = adj;
+    return old;
+}
+
+void *sbrk(intptr_t increment) { return vm_sbrk(increment); }
+
+int vmstat(struct vmstat *st) {
+    if (!vm_get_stats(st)) {
+        exit(-1);
+    }
+    return 0;
+}
+
+/* Reserve RUNTIME ticks in every PERIOD ticks for the calling
+ * process, due within DEADLINE ticks of each period's start. */
+int sched_deadline(unsigned runtime, unsigned deadline, unsigned period) {
+    return thread_set_deadline(runtime, deadline, period) ? 0 : -1;
+}
+
+/* Store the current time of CLOCK in *TS.  CLOCK_MONOTONIC, the time
+ * since boot at nanosecond resolution, is the only clock. */
+int clock_gettime(int clock, struct timespec *ts) {
+    int64_t ns;
+
+    if (clock != CLOCK_MONOTONIC) {
+        return -1;
+    }
+    validate_buffer(ts, sizeof *ts, true);
+    ns = timer_ns();
+    ts->tv_sec = ns / 1000000000;
+    ts->tv_nsec = ns % 1000000000;
+    return 0;
+}
@@ -1,6 +1,8 @@
 /* anon.c: Implementation of page for non-disk image (a.k.a. anonymous page). */
 
 #include <bitmap.h>
+#include <round.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "devices/disk.h"
@@ -8,11 +10,33 @@
 #include "lib/string.h"
 #include "vm/vm.h"
 /* DO NOT MODIFY BELOW LINE */
-static struct disk *swap_disk;
 static bool anon_swap_in(struct page *page, void *kva);
 static bool anon_swap_out(struct page *page);
 static void anon_destroy(struct page *page);
 
+/* A swap device.  Its slots are numbered from FIRST_SLOT in the single
+ * slot space that anon_page.swap_sector refers to. */
+struct swap_dev {
+    struct disk *disk;
+    int chan_no, dev_no; // -swap=CHAN:DEV
+    int prio;            // higher is used first.
+    size_t first_slot;   // global number of this device's slot 0.
+    size_t slot_cnt;
+    struct bitmap *used; // slots in use.
+    size_t used_cnt;     // slots in use, for statistics.
+    unsigned out_cnt;    // pages written.
+    unsigned in_cnt;     // pages read.
+};
+
+/* Registered swap devices, highest priority first. */
+static struct swap_dev swap_devs[SWAP_DEV_MAX];
+static size_t swap_dev_cnt;
+/* Rotates page-outs among devices of equal priority. */
+static unsigned swap_rotor;
+/* Protects the slot bitmaps and counters; evictions of different
+ * processes may overlap. */
+static struct lock swap_lock;
+
 /* DO NOT MODIFY this struct */
 static const struct page_operations anon_ops = {
     .swap_in = anon_swap_in,
@@ -21,12 +45,119 @@ static const struct page_operations anon_ops = {
     .type = VM_ANON,
 };
 
+/* Use disk DEV_NO on channel CHAN_NO for swap, before devices of lower
+ * PRIO.  Called while parsing the kernel command line (-swap), before
+ * the disks are probed, so only the request is recorded here. */
+void vm_swap_register(int chan_no, int dev_no, int prio) {
+    struct swap_dev *d;
+
+    if (swap_dev_cnt >= SWAP_DEV_MAX) {
+        PANIC("too many swap devices (at most %d)", SWAP_DEV_MAX);
+    }
+    // 우선순위가 높은 장치가 앞에 오도록 끼워 넣는다.
+    for (d = swap_devs + swap_dev_cnt; d > swap_devs && d[-1].prio < prio;
+         d--) {
+        d[0] = d[-1];
+    }
+    memset(d, 0, sizeof *d);
+    d->chan_no = chan_no;
+    d->dev_no = dev_no;
+    d->prio = prio;
+    swap_dev_cnt++;
+}
+
 /* Initialize the data for anonymous pages */
 void vm_anon_init(void) {
     /* TODO: Set up the swap_disk. */
-    swap_disk = disk_get(1, 1);   // get swap disk, (1=채널번호,1=디스크번호)는 스왑디스크를 위한 공간.
-    size_t swap_size = disk_size(swap_disk)/SECTOR_CNT; 
-    swap_table = bitmap_create(swap_size);  //스왑테이블 생성 by 비트맵. -> 각 비트는 섹터가 사용중 여부를 알려줌.
+    size_t first_slot = 0;
+    size_t i, j;
+
+    // 지정하지 않으면 1번 채널 1번 디스크가 스왑디스크.
+    if (swap_dev_cnt == 0) {
+        vm_swap_register(1, 1, 0);
+    }
+    for (i = j = 0; i < swap_dev_cnt; i++) {
+        struct swap_dev d = swap_devs[i];
+
+        d.disk = disk_get(d.chan_no, d.dev_no);
+        if (d.disk == NULL) {
+            printf("swap: no disk hd%d:%d, skipping\n", d.chan_no, d.dev_no);
+            continue;
+        }
+        d.first_slot = first_slot;
+        d.slot_cnt = disk_size(d.disk) / SECTOR_CNT;
+        d.used = bitmap_create(d.slot_cnt);  // 각 비트는 slot이 사용중인지를 알려줌.
+        if (d.used == NULL) {
+            PANIC("swap: bitmap creation failed for hd%d:%d", d.chan_no,
+                  d.dev_no);
+        }
+        first_slot += d.slot_cnt;
+        swap_devs[j++] = d;
+    }
+    swap_dev_cnt = j;
+    lock_init(&swap_lock);
+}
+
+/* Returns the device that holds global swap slot SLOT. */
+static struct swap_dev *swap_dev_of(size_t slot) {
+    struct swap_dev *d;
+
+    for (d = swap_devs; d < swap_devs + swap_dev_cnt; d++) {
+        if (slot - d->first_slot < d->slot_cnt) {
+            return d;
+        }
+    }
+    NOT_REACHED();
+}
+
+/* Take a free swap slot and return its global number, or BITMAP_ERROR
+ * if every device is full.  Devices of higher priority fill up first;
+ * among devices of equal priority, consecutive calls go to different
+ * devices so that page-outs keep both IDE channels busy. */
+static size_t swap_alloc(void) {
+    size_t slot = BITMAP_ERROR;
+    size_t i, j, k;
+
+    lock_acquire(&swap_lock);
+    for (i = 0; i < swap_dev_cnt && slot == BITMAP_ERROR; i = j) {
+        for (j = i; j < swap_dev_cnt && swap_devs[j].prio == swap_devs[i].prio;
+             j++) {
+            continue;
+        }
+        for (k = 0; k < j - i; k++) {
+            struct swap_dev *d = &swap_devs[i + (swap_rotor + k) % (j - i)];
+            size_t idx = bitmap_scan_and_flip(d->used, 0, 1, false);
+            if (idx != BITMAP_ERROR) {
+                d->used_cnt++;
+                d->out_cnt++;
+                swap_rotor += k + 1;
+                slot = d->first_slot + idx;
+                break;
+            }
+        }
+    }
+    lock_release(&swap_lock);
+    return slot;
+}
+
+/* Release swap slot SLOT.  The caller holds swap_lock. */
+static void swap_free(size_t slot) {
+    struct swap_dev *d = swap_dev_of(slot);
+
+    bitmap_set(d->used, slot - d->first_slot, false);
+    d->used_cnt--;
+}
+
+/* Prints usage of each swap device. */
+void vm_swap_print_stats(void) {
+    struct swap_dev *d;
+
+    for (d = swap_devs; d < swap_devs + swap_dev_cnt; d++) {
+        printf("Swap hd%d:%d (priority %d): %zu of %zu slots in use, "
+               "%u pages out, %u pages in\n",
+               d->chan_no, d->dev_no, d->prio, d->used_cnt, d->slot_cnt,
+               d->out_cnt, d->in_cnt);
+    }
 }
 
 /* Initialize the file mapping */
@@ -35,12 +166,14 @@ bool anon_initializer(struct page *page, enum vm_type type, void *kva) {
     if (page == NULL || kva == NULL) return false;
 
     struct uninit_page *uninit_page = &page->uninit;
+    void *map_start = type & VM_ANON_MAP ? uninit_page->aux : NULL;
     memset(uninit_page, 0, sizeof(struct uninit_page));  //uninit page 0으로 초기화
 
     page->operations = &anon_ops; //page->operations를 anon을 위한 ops로 변경.
 
     struct anon_page *anon_page = &page->anon;
     anon_page->swap_sector = -1;  //디스크의 어떤 섹터에도 매핑되지 않은상태.
+    anon_page->map_start = map_start;
     return true;
 }
 
@@ -48,18 +181,31 @@ bool anon_initializer(struct page *page, enum vm_type type, void *kva) {
 static bool anon_swap_in(struct page *page, void *kva) {
     struct anon_page *anon_page = &page->anon;
 
-    size_t swap_idx = anon_page->swap_sector;
+    /* Discarded by madvise(MADV_DONTNEED): hand back a zero page. */
+    if (anon_page->swap_sector == -1) {
+        memset(kva, 0, PGSIZE);
+        return true;
+    }
+
+    size_t slot = anon_page->swap_sector;
+    struct swap_dev *d = swap_dev_of(slot);
+    size_t swap_idx = slot - d->first_slot;
 
-    if (!bitmap_test(swap_table, swap_idx)) 
-        return false;  //swap_idx의 비트맵이, 해당 섹터의 사용여부를 알려준다.
-        //bitmap_test -> false시 해당 섹터에 데이터가 없음.
+    if (!bitmap_test(d->used, swap_idx)) 
+        return false;  //swap_idx의 비트맵이, 해당 slot의 사용여부를 알려준다.
+        //bitmap_test -> false시 해당 slot에 데이터가 없음.
 
     for (int i = 0; i < SECTOR_CNT; i++) {
-        disk_read(swap_disk, swap_idx * SECTOR_CNT + i, kva + DISK_SECTOR_SIZE * i);
+        disk_read(d->disk, swap_idx * SECTOR_CNT + i, kva + DISK_SECTOR_SIZE * i);
         // 2번째인자-> 읽어올 섹터의 위치, 3번째인자-> 쓸 메모리의 주소.
         // 디스크 -> 메모리 방향으로의 이동.
     }
-    bitmap_set(swap_table, swap_idx, false); //swap idx를 false로 바꿈 -> 디스크섹터에는 자리가 비게된다.
+    lock_acquire(&swap_lock);
+    d->in_cnt++;
+    swap_free(slot); //slot을 비움 -> 디스크에는 자리가 비게된다.
+    lock_release(&swap_lock);
+    anon_page->swap_sector = -1;
+    page->frame->owner->swap_pages--;
 
     return true;
 }
@@ -69,26 +215,178 @@ static bool anon_swap_in(struct page *page, void *kva) {
 static bool anon_swap_out(struct page *page) {
     struct anon_page *anon_page = &page->anon;
 
-    size_t empty_slot = bitmap_scan(swap_table, 0, 1, false); //비어있는 섹터 찾기.
+    size_t empty_slot = swap_alloc(); //비어있는 slot 찾아 사용중으로 전환.
 
-    if (empty_slot == BITMAP_ERROR) { //섹터 꽉찬상태
+    if (empty_slot == BITMAP_ERROR) { //모든 장치가 꽉찬상태
         return false;
     }
 
+    struct swap_dev *d = swap_dev_of(empty_slot);
+    size_t swap_idx = empty_slot - d->first_slot;
+
+    // 쓰는 도중 주인 프로세스가 값을 바꾸지 못하도록 매핑부터 끊는다.
+    pml4_clear_page(page->frame->owner->pml4, page->va);
+
     for (int i=0; i < SECTOR_CNT; i++) {
-        disk_write(swap_disk, empty_slot * SECTOR_CNT + i, page->va + DISK_SECTOR_SIZE * i);
+        disk_write(d->disk, swap_idx * SECTOR_CNT + i, page->frame->kva + DISK_SECTOR_SIZE * i);
     }  //2번째인자-> 쓸 섹터의 위치, 3번째인자-> 읽어올 메모리 주소.
        //메모리 -> 디스크로의 이동.
 
-    bitmap_set(swap_table, empty_slot, true); //섹터 사용 여부  true로 전환.
-    pml4_clear_page(thread_current()->pml4, page->va);
-
     anon_page->swap_sector = empty_slot;
+    page->frame->owner->swap_pages++;
     return true;
 }
 
+/* Forget the contents of PAGE, which belongs to OWNER, releasing its
+ * swap slot if it has one.  The next fault maps a zero-filled page. */
+void anon_discard(struct page *page, struct thread *owner) {
+    struct anon_page *anon_page = &page->anon;
+
+    if (anon_page->swap_sector != -1) {
+        lock_acquire(&swap_lock);
+        swap_free(anon_page->swap_sector);
+        lock_release(&swap_lock);
+        anon_page->swap_sector = -1;
+        owner->swap_pages--;
+    }
+}
+
+/* Give back every swap slot held by OWNER's pages in SPT, taking the
+ * swap lock once rather than once per page.  The caller holds SPT's
+ * lock. */
+void anon_release_swap(struct supplemental_page_table *spt,
+                       struct thread *owner) {
+    struct hash_iterator i;
+
+    if (owner->swap_pages == 0) {
+        return;
+    }
+    lock_acquire(&swap_lock);
+    hash_first(&i, &spt->hash_table);
+    while (hash_next(&i)) {
+        struct page *page = hash_entry(hash_cur(&i), struct page, hash_elem);
+        if (VM_TYPE(page->operations->type) == VM_ANON &&
+            page->anon.swap_sector != -1) {
+            swap_free(page->anon.swap_sector);
+            page->anon.swap_sector = -1;
+        }
+    }
+    owner->swap_pages = 0;
+    lock_release(&swap_lock);
+}
+
+/* Returns the start of the anonymous mapping PAGE belongs to, or NULL
+ * if it is not part of one. */
+static void *anon_map_start(struct page *page) {
+    if (VM_TYPE(page->operations->type) == VM_UNINIT) {
+        return page->uninit.type & VM_ANON_MAP ? page->uninit.aux : NULL;
+    }
+    return page->anon.map_start;
+}
+
+/* Find LENGTH bytes of unused address space for an anonymous mapping,
+ * working down from the last one toward the heap.  If that runs into
+ * the heap, search again from the top for holes left by munmap. */
+static void *anon_mmap_find(size_t length) {
+    struct thread *curr = thread_current();
+    void *bottom = pg_round_up(curr->heap_brk);
+    void *top = curr->mmap_hint;
+    bool wrapped = false;
+
+    for (;;) {
+        void *start = top - length;
+        void *va;
+
+        if (top - bottom < (ptrdiff_t)length) {
+            if (wrapped) {
+                return NULL;
+            }
+            top = (void *)STACK_GUARD;
+            wrapped = true;
+            continue;
+        }
+        // 겹치는 가장 높은 페이지 아래에서 다시 찾는다.
+        for (va = top - PGSIZE; va >= start; va -= PGSIZE) {
+            if (spt_find_page(&curr->spt, va) != NULL) {
+                break;
+            }
+        }
+        if (va < start) {
+            if (start < curr->mmap_hint) {
+                curr->mmap_hint = start;
+            }
+            return start;
+        }
+        top = va;
+    }
+}
+
+/* Map LENGTH bytes of zero-filled memory at ADDR, or wherever there is
+ * room if ADDR is NULL.  WRITABLE may carry MAP_POPULATE.  Returns the
+ * address of the mapping or NULL on failure. */
+void *do_anon_mmap(void *addr, size_t length, int writable) {
+    struct supplemental_page_table *spt = &thread_current()->spt;
+    bool populate = (writable & MAP_POPULATE) != 0;
+    void *va;
+
+    writable &= ~MAP_POPULATE;
+    length = ROUND_UP(length, PGSIZE);
+    if (addr == NULL && (addr = anon_mmap_find(length)) == NULL) {
+        return NULL;
+    }
+    if (addr + length < addr || is_kernel_vaddr(addr + length - 1) ||
+        vm_overlaps_stack(addr, length)) {
+        return NULL;
+    }
+    for (va = addr; va < addr + length; va += PGSIZE) {
+        if (spt_find_page(spt, va) != NULL) {
+            return NULL;
+        }
+    }
+
+    for (va = addr; va < addr + length; va += PGSIZE) {
+        if (!vm_alloc_page_with_initializer(VM_ANON | VM_ANON_MAP, va,
+                                            writable, NULL, addr)) {
+            do_anon_munmap(addr);
+            return NULL;
+        }
+    }
+    if (populate) {
+        vm_populate(addr, length);
+    }
+    return addr;
+}
+
+/* Unmap the anonymous mapping that starts at ADDR. */
+void do_anon_munmap(void *addr) {
+    struct thread *curr = thread_current();
+    struct supplemental_page_table *spt = &curr->spt;
+    struct page *page;
+    void *va = addr;
+
+    lock_acquire(&spt->lock);
+    while ((page = spt_find_page(spt, va)) != NULL &&
+           page_get_type(page) == VM_ANON && anon_map_start(page) == addr) {
+        spt_remove_page(spt, page);
+        va += PGSIZE;
+    }
+    // 가장 최근 매핑이 풀리면 그 자리를 다음 매핑에 다시 쓴다.
+    if (addr == curr->mmap_hint) {
+        curr->mmap_hint = va;
+    }
+    lock_release(&spt->lock);
+}
+
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void anon_destroy(struct page *page) {
-    
-    struct anon_page *anon_page = &page->anon;
+    struct frame *frame = page->frame;
+
+    anon_discard(page, thread_current());
+    if (frame != NULL) {
+        if (thread_current()->pml4 != NULL) {
+            pml4_clear_page(thread_current()->pml4, page->va);
+        }
+        page->frame = NULL;
+        vm_free_frame(frame);
+    }
 }
@@ -2,13 +2,17 @@
 
 #include <string.h>
 
+#include "threads/malloc.h"
 #include "threads/mmu.h"
+#include "threads/thread.h"
 #include "userprog/process.h"
 #include "vm/vm.h"
 
 static bool file_backed_swap_in(struct page *page, void *kva);
 static bool file_backed_swap_out(struct page *page);
 static void file_backed_destroy(struct page *page);
+static void file_backed_writeback(struct page *page);
+static void flusher(void *aux UNUSED);
 
 void do_munmap(void *addr);
 void *do_mmap(void *addr, size_t length, int writable, struct file *file,
@@ -21,15 +25,54 @@ static const struct page_operations file_ops = {
     .type = VM_FILE,
 };
 
+/* Every initialized file-backed page, in no particular order; each
+ * flush pass sorts what it is about to write. */
+static struct list mmap_pages;
+/* Protects mmap_pages and the writing flag of every file page.  Not
+ * held across disk writes. */
+static struct lock mmap_lock;
+/* Signaled, with mmap_lock, whenever a write-back finishes. */
+static struct condition mmap_written;
+
 /* The initializer of file vm */
-void vm_file_init(void) {}
+void vm_file_init(void) {
+    list_init(&mmap_pages);
+    lock_init(&mmap_lock);
+    cond_init(&mmap_written);
+    thread_create("flusher", PRI_DEFAULT, flusher, NULL);
+}
+
+/* Returns true if file page A comes before file page B on disk. */
+static bool file_page_less(const struct list_elem *a_,
+                           const struct list_elem *b_, void *aux UNUSED) {
+    const struct file_page *a = list_entry(a_, struct file_page, flush_elem);
+    const struct file_page *b = list_entry(b_, struct file_page, flush_elem);
+    struct inode *inode_a = file_get_inode(a->info->file);
+    struct inode *inode_b = file_get_inode(b->info->file);
+
+    if (inode_a != inode_b) {
+        return inode_a < inode_b;
+    }
+    return a->info->ofs < b->info->ofs;
+}
 
 /* Initialize the file backed page */
 bool file_backed_initializer(struct page *page, enum vm_type type, void *kva) {
+    /* Fetch first, file_page overlaps the uninit_page. */
+    struct lazy_load_info *info = (struct lazy_load_info *)page->uninit.aux;
+
     /* Set up the handler */
     page->operations = &file_ops;
 
     struct file_page *file_page = &page->file;
+    file_page->info = info;
+    file_page->owner = thread_current();
+    file_page->writing = false;
+    file_page->listed = true;
+
+    lock_acquire(&mmap_lock);
+    list_push_back(&mmap_pages, &file_page->mmap_elem);
+    lock_release(&mmap_lock);
     return true;
 }
 
@@ -39,53 +82,201 @@ static bool file_backed_swap_in(struct page *page, void *kva) {
         return false;
     }
 
-    struct file_page *file_page UNUSED = &page->file;
+    struct lazy_load_info *info = page->file.info;
+
+    if (file_read_at(info->file, kva, info->read_bytes, info->ofs) !=
+        (int)info->read_bytes) {
+        return false;
+    }
 
-    struct lazy_load_info *aux = (struct lazy_load_info *)page->uninit.aux;
-    struct file *file = aux->file;
-    off_t offset = aux->ofs;
-    size_t page_read_bytes = aux->read_bytes;
-    size_t page_zero_bytes = aux->zero_bytes;
+    memset(kva + info->read_bytes, 0, info->zero_bytes);
 
-    file_seek(file, offset);
+    return true;
+}
 
-    if (file_read(file, kva, page_read_bytes) != (int)page_read_bytes) {
-        return false;
+/* Wait until no write-back of PAGE is in flight.  The caller holds
+ * mmap_lock. */
+static void writeback_wait(struct page *page) {
+    while (page->file.writing) {
+        cond_wait(&mmap_written, &mmap_lock);
     }
+}
+
+/* Start writing PAGE back if it is mapped and dirty.  The dirty bit is
+ * cleared first, so that stores racing with the write re-dirty it, and
+ * the frame is marked busy so that the evictor leaves it alone until
+ * writeback_end().  Returns false if there is nothing to write, or if
+ * the frame is being evicted and the evictor writes it instead.  The
+ * caller holds mmap_lock. */
+static bool writeback_begin(struct page *page) {
+    struct file_page *file_page = &page->file;
+    uint64_t *pml4 = file_page->owner->pml4;
 
-    memset(kva + page_read_bytes, 0, page_zero_bytes);
+    ASSERT(lock_held_by_current_thread(&mmap_lock));
 
+    if (file_page->writing || page->frame == NULL || pml4 == NULL ||
+        pml4_get_page(pml4, page->va) == NULL ||
+        !pml4_is_dirty(pml4, page->va) || !vm_try_busy_frame(page->frame)) {
+        return false;
+    }
+    pml4_set_dirty(pml4, page->va, false);
+    file_page->writing = true;
     return true;
 }
 
+/* Write the frame of PAGE to its file.  Called without mmap_lock,
+ * between writeback_begin() and writeback_end(). */
+static void writeback_io(struct page *page) {
+    struct lazy_load_info *info = page->file.info;
+
+    file_write_at(info->file, page->frame->kva, info->read_bytes, info->ofs);
+}
+
+/* Finish the write-back of PAGE started by writeback_begin().  The
+ * caller holds mmap_lock. */
+static void writeback_end(struct page *page) {
+    page->file.writing = false;
+    vm_unbusy_frame(page->frame);
+    cond_broadcast(&mmap_written, &mmap_lock);
+}
+
+/* Write PAGE back to its file if it is mapped and dirty, waiting for
+ * a write-back already in flight first.  The caller holds mmap_lock,
+ * which is released during the write. */
+static void file_backed_writeback(struct page *page) {
+    writeback_wait(page);
+    if (writeback_begin(page)) {
+        lock_release(&mmap_lock);
+        writeback_io(page);
+        lock_acquire(&mmap_lock);
+        writeback_end(page);
+    }
+}
+
 /* Swap out the page by writeback contents to the file. */
 static bool file_backed_swap_out(struct page *page) {
     if (page == NULL) {
         return false;
     }
 
-    struct file_page *file_page UNUSED = &page->file;
-    struct lazy_load_info *aux = (struct lazy_load_info *)page->uninit.aux;
-    struct file *file = aux->file;
+    struct file_page *file_page = &page->file;
+    uint64_t *pml4 = file_page->owner->pml4;
+    bool dirty;
+
+    /* Unmap first so that the owner cannot store into the frame while
+     * it is being written; the dirty bit survives pml4_clear_page().
+     * The evictor already holds the frame busy. */
+    lock_acquire(&mmap_lock);
+    writeback_wait(page);
+    pml4_clear_page(pml4, page->va);
+    dirty = pml4_is_dirty(pml4, page->va);
+    if (dirty) {
+        pml4_set_dirty(pml4, page->va, false);
+        file_page->writing = true;
+    }
+    lock_release(&mmap_lock);
 
-    if (pml4_is_dirty(thread_current()->pml4, page->va)) {
-        file_write_at(file, page->va, aux->read_bytes, aux->ofs);
-        pml4_set_dirty(thread_current()->pml4, page->va, false);
+    if (dirty) {
+        writeback_io(page);
+        lock_acquire(&mmap_lock);
+        file_page->writing = false;
+        cond_broadcast(&mmap_written, &mmap_lock);
+        lock_release(&mmap_lock);
     }
-    pml4_clear_page(thread_current()->pml4, page->va);
     return true;
 }
 
 /* Destory the file backed page. PAGE will be freed by the caller. */
 static void file_backed_destroy(struct page *page) {
-    struct file_page *file_page UNUSED = &page->file;
-    struct thread *curr = thread_current();
-    struct lazy_load_info* info = (struct lazy_load_info*)page->uninit.aux;
-    if (pml4_is_dirty(curr->pml4, page->va)){
-    	file_write_at(info->file, page->va, info->read_bytes, info->ofs);
-    	pml4_set_dirty(curr->pml4, page->va,0);
+    struct file_page *file_page = &page->file;
+    struct frame *frame = page->frame;
+
+    lock_acquire(&mmap_lock);
+    file_backed_writeback(page);
+    if (file_page->listed) {
+        list_remove(&file_page->mmap_elem);
+    }
+    if (frame != NULL && file_page->owner->pml4 != NULL) {
+        pml4_clear_page(file_page->owner->pml4, page->va);
+    }
+    lock_release(&mmap_lock);
+
+    if (frame != NULL) {
+        page->frame = NULL;
+        vm_free_frame(frame);
     }
-    pml4_clear_page(curr->pml4, page->va);
+}
+
+/* Write back every dirty mmap page of OWNER, or of every process if
+ * OWNER is NULL, in file-offset order.  The pages are collected and
+ * sorted under mmap_lock, but written without it, so faults and
+ * evictions elsewhere do not wait behind the disk. */
+void vm_file_flush(struct thread *owner) {
+    struct list batch;
+    struct list_elem *e;
+
+    list_init(&batch);
+    lock_acquire(&mmap_lock);
+    for (e = list_begin(&mmap_pages); e != list_end(&mmap_pages);
+         e = list_next(e)) {
+        struct page *page = list_entry(e, struct page, file.mmap_elem);
+        if ((owner == NULL || page->file.owner == owner) &&
+            writeback_begin(page)) {
+            list_push_back(&batch, &page->file.flush_elem);
+        }
+    }
+    lock_release(&mmap_lock);
+
+    list_sort(&batch, file_page_less, NULL);
+    for (e = list_begin(&batch); e != list_end(&batch); e = list_next(e)) {
+        writeback_io(list_entry(e, struct page, file.flush_elem));
+    }
+
+    lock_acquire(&mmap_lock);
+    while (!list_empty(&batch)) {
+        e = list_pop_front(&batch);
+        writeback_end(list_entry(e, struct page, file.flush_elem));
+    }
+    lock_release(&mmap_lock);
+}
+
+/* Take the pages of OWNER, whose page table is about to be torn down,
+ * off the write-back list once their write-backs in flight are done,
+ * so that the flusher no longer reads their frames. */
+void vm_file_detach(struct thread *owner) {
+    struct list_elem *e;
+
+    lock_acquire(&mmap_lock);
+    e = list_begin(&mmap_pages);
+    while (e != list_end(&mmap_pages)) {
+        struct page *page = list_entry(e, struct page, file.mmap_elem);
+        if (page->file.owner != owner) {
+            e = list_next(e);
+            continue;
+        }
+        writeback_wait(page);
+        e = list_remove(e);
+        page->file.listed = false;
+    }
+    lock_release(&mmap_lock);
+}
+
+/* Background write-back thread: periodically cleans dirty mmap pages
+ * so that munmap, exit and eviction rarely have to write. */
+static void flusher(void *aux UNUSED) {
+    for (;;) {
+        timer_sleep(FLUSH_INTERVAL);
+        vm_file_flush(NULL);
+    }
+}
+
+/* Returns the mapping information of file-backed PAGE, whether or not
+ * it has been faulted in yet. */
+static struct lazy_load_info *page_info(struct page *page) {
+    if (VM_TYPE(page->operations->type) == VM_UNINIT) {
+        return (struct lazy_load_info *)page->uninit.aux;
+    }
+    return page->file.info;
 }
 
 void *do_mmap(void *addr, size_t length, int writable, struct file *file,
@@ -93,6 +284,8 @@ void *do_mmap(void *addr, size_t length, int writable, struct file *file,
     struct file *f = file_reopen(file);
     void *start_addr =
         addr;  // 매핑 성공 시 파일이 매핑된 가상 주소 반환하는 데 사용
+    bool populate = (writable & MAP_POPULATE) != 0;
+    writable &= ~MAP_POPULATE;
 
     size_t read_bytes = file_length(f) < length ? file_length(f) : length;
     size_t zero_bytes = PGSIZE - read_bytes % PGSIZE;
@@ -129,34 +322,57 @@ void *do_mmap(void *addr, size_t length, int writable, struct file *file,
         offset += page_read_bytes;
     }
 
+    // MAP_POPULATE: 첫 접근 때마다 fault를 내는 대신 지금 순서대로 읽어 둔다.
+    if (populate) {
+        vm_populate(start_addr, length);
+    }
     return start_addr;
 }
 
+/* Unmap the mapping that starts at ADDR.  Dirty pages are written back
+ * by the page destructor. */
 void do_munmap(void *addr) {
-    while (true) {
-        struct thread *curr = thread_current();
-        struct page *find_page = spt_find_page(&curr->spt, addr);
-        // struct frame *find_frame =find_page->frame;
-
-        if (find_page == NULL) {
-            return NULL;
-        }
+    struct thread *curr = thread_current();
+    struct page *page = spt_find_page(&curr->spt, addr);
+    struct file *file;
 
-        struct lazy_load_info *container =
-            (struct lazy_load_info *)find_page->uninit.aux;
-        // 페이지의 dirty bit이 1이면 true를, 0이면 false를 리턴한다.
-        if (pml4_is_dirty(curr->pml4, find_page->va)) {
-            // 물리 프레임에 변경된 데이터를 다시 디스크 파일에 업데이트
-            // buffer에 있는 데이터를 size만큼, file의 file_ofs부터 써준다.
-            file_write_at(container->file, addr, container->read_bytes,
-                          container->ofs);
-            // dirty bit = 0
-            // 인자로 받은 dirty의 값이 1이면 page의 dirty bit을 1로, 0이면
-            // 0으로 변경해준다.
-            pml4_set_dirty(curr->pml4, find_page->va, 0);
-        }
+    if (page != NULL && page_get_type(page) == VM_ANON) {
+        do_anon_munmap(addr);
+        return;
+    }
+    if (page == NULL || page_get_type(page) != VM_FILE) {
+        return;
+    }
 
-        pml4_clear_page(curr->pml4, find_page->va);
+    // 같은 mmap 호출로 만들어진 페이지들은 같은 file을 공유한다.
+    file = page_info(page)->file;
+    lock_acquire(&curr->spt.lock);
+    while (page != NULL && page_get_type(page) == VM_FILE &&
+           page_info(page)->file == file) {
+        spt_remove_page(&curr->spt, page);
         addr += PGSIZE;
+        page = spt_find_page(&curr->spt, addr);
     }
-}
\ No newline at end of file
+    lock_release(&curr->spt.lock);
+}
+
+/* Write back the dirty file-backed pages in [ADDR, ADDR + LENGTH).
+ * Returns 0 on success, -1 if part of the range is not mapped. */
+int do_msync(void *addr, size_t length) {
+    struct supplemental_page_table *spt = &thread_current()->spt;
+    int result = 0;
+
+    for (void *va = addr; va < addr + length; va += PGSIZE) {
+        struct page *page = spt_find_page(spt, va);
+        if (page == NULL) {
+            result = -1;
+            continue;
+        }
+        if (VM_TYPE(page->operations->type) == VM_FILE) {
+            lock_acquire(&mmap_lock);
+            file_backed_writeback(page);
+            lock_release(&mmap_lock);
+        }
+    }
+    return result;
+}
@@ -2,31 +2,79 @@
 
 #include "vm/vm.h"
 
+#include <round.h>
 #include <stdio.h>
 
+#include <inttypes.h>
+#include <string.h>
+
 #include "include/lib/kernel/hash.h"
+#include "intrinsic.h"
 #include "threads/malloc.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
+#include "userprog/process.h"
 #include "vm/inspect.h"
-struct list frame_table;
-struct list_elem *clock_ref;
-struct lock frame_table_lock;
+/* Frame table: one entry per user pool page, indexed by page number
+ * from frame_base. */
+static struct frame *frame_table;
+static size_t frame_cnt;
+static uint8_t *frame_base;
+static size_t clock_hand;  // next entry the clock looks at.
+struct mutex frame_table_lock;
+static void vm_wss_sampler(void *aux UNUSED);
+static void vm_frame_init(void);
+static unsigned *vm_fault_counter(struct thread *curr, struct page *page);
+static void vm_record_latency(uint64_t cycles);
+
+/* Load control. */
+unsigned vm_thrash_threshold = THRASH_DEFAULT;
+static unsigned vm_fault_cnt;       /* Page faults handled. */
+static unsigned vm_evict_cnt;       /* Frames taken by eviction. */
+static uint64_t vm_fault_hist[VMSTAT_BUCKETS]; /* Fault latency, log2. */
+static unsigned vm_suspend_cnt;     /* Processes suspended for thrashing. */
+static struct list suspended_list;  /* Processes held back, oldest first. */
+static struct lock load_lock;       /* Protects the above and vm_suspended. */
+static struct condition load_cond;  /* Signaled when a process resumes. */
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
 void vm_init(void) {
     vm_anon_init();
     vm_file_init();
-    list_init(&frame_table);
+    vm_frame_init();
 #ifdef EFILESYS /* For project 4 */
     pagecache_init();
 #endif
     register_inspect_intr();
-    lock_init(&frame_table_lock);
+    mutex_init(&frame_table_lock);
     lock_init(&kill_lock);
 
     /* DO NOT MODIFY UPPER LINES. */
     /* TODO: Your code goes here. */
+    list_init(&suspended_list);
+    lock_init(&load_lock);
+    cond_init(&load_cond);
+    thread_create("wss", PRI_DEFAULT, vm_wss_sampler, NULL);
+}
+
+/* Allocate the frame table, sized to cover the whole user pool. */
+static void vm_frame_init(void) {
+    size_t pages;
+
+    palloc_user_pool((void **)&frame_base, &frame_cnt);
+    pages = DIV_ROUND_UP(frame_cnt * sizeof *frame_table, PGSIZE);
+    frame_table = palloc_get_multiple(PAL_ASSERT | PAL_ZERO, pages);
+    for (size_t i = 0; i < frame_cnt; i++) {
+        frame_table[i].kva = frame_base + i * PGSIZE;
+    }
+}
+
+/* Returns the frame table entry of user pool page KVA. */
+static struct frame *vm_kva_to_frame(void *kva) {
+    size_t idx = ((uint8_t *)kva - frame_base) / PGSIZE;
+
+    ASSERT(idx < frame_cnt);
+    return &frame_table[idx];
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -46,16 +94,28 @@ enum vm_type page_get_type(struct page *page) {
 static struct frame *vm_get_victim(void);
 static bool vm_do_claim_page(struct page *page);
 static struct frame *vm_evict_frame(void);
+static void vm_drop_page(struct thread *owner, struct page *page);
+static void vm_sequential_fault(struct supplemental_page_table *spt,
+                                struct page *page);
+static bool vm_do_claim_page_for(struct thread *owner, struct page *page);
+static bool vm_lock_owner(struct thread *owner);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
- * `vm_alloc_page`. */
+ * `vm_alloc_page`.  The SPT lock is taken here unless the caller holds
+ * it already, so that another thread walking the table under the lock
+ * (the OOM killer) never sees a half-done insert or rehash. */
 bool vm_alloc_page_with_initializer(enum vm_type type, void *upage,
                                     bool writable, vm_initializer *init,
                                     void *aux) {
     ASSERT(VM_TYPE(type) != VM_UNINIT)
     struct supplemental_page_table *spt = &thread_current()->spt;
+    bool locked = !lock_held_by_current_thread(&spt->lock);
+    bool success = false;
 
+    if (locked) {
+        lock_acquire(&spt->lock);
+    }
     /* Check wheter the upage is already occupied or not. */
     if (spt_find_page(spt, upage) == NULL) {
         /* TODO: Create the page, fetch the initialier according to the VM type,
@@ -68,19 +128,21 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage,
 
         if (VM_TYPE(type) == VM_ANON) {
             new_initializer = anon_initializer;
-            uninit_new(new_page, upage, init, VM_ANON, aux, new_initializer);
+            uninit_new(new_page, upage, init, type, aux, new_initializer);
         }
         if (VM_TYPE(type) == VM_FILE) {
             new_initializer = file_backed_initializer;
-            uninit_new(new_page, upage, init, VM_FILE, aux, new_initializer);
+            uninit_new(new_page, upage, init, type, aux, new_initializer);
         }
 
         /* TODO: Insert the page into the spt. */
         new_page->writable = writable;
-        return spt_insert_page(spt, new_page);
+        success = spt_insert_page(spt, new_page);
     }
-err:
-    return false;
+    if (locked) {
+        lock_release(&spt->lock);
+    }
+    return success;
 }
 
 /* Find VA from spt and return page. On error, return NULL. */
@@ -89,16 +151,13 @@ err:
 실패했을 경우 NULL를 반환합니다.*/
 struct page *spt_find_page(struct supplemental_page_table *spt UNUSED,
                            void *va UNUSED) {
-    struct page *page = NULL;
+    struct page page;
     /* TODO: Fill this function. */
-    page = (struct page *)malloc(sizeof(struct page));
     struct hash_elem *h_e;
 
-    page->va = pg_round_down(va);  // va를 페이지 경계로 내림하는 기능
-
-    h_e = hash_find(&spt->hash_table, &page->hash_elem);
+    page.va = pg_round_down(va);  // va를 페이지 경계로 내림하는 기능
 
-    free(page);
+    h_e = hash_find(&spt->hash_table, &page.hash_elem);
 
     if (h_e == NULL) {
         return NULL;
@@ -121,91 +180,468 @@ bool spt_insert_page(struct supplemental_page_table *spt UNUSED,
 }
 
 void spt_remove_page(struct supplemental_page_table *spt, struct page *page) {
+    hash_delete(&spt->hash_table, &page->hash_elem);
     vm_dealloc_page(page);
-    return true;
 }
 
-/* Get the struct frame, that will be evicted. */
+/* Take the SPT lock of OWNER so that one of its frames can be evicted.
+ * Never blocks: returns false if some other thread is working on that
+ * address space.  The current process's own lock is already held by
+ * the fault handler. */
+static bool vm_lock_owner(struct thread *owner) {
+    struct lock *lock = &owner->spt.lock;
+
+    if (owner == thread_current()) {
+        return true;
+    }
+    if (lock_held_by_current_thread(lock)) {
+        return false;
+    }
+    return lock_try_acquire(lock);
+}
+
+/* Victim classes, tried in order by vm_get_victim(). */
+enum victim_class {
+    VICTIM_OWN,        /* Frames of the current process only. */
+    VICTIM_OVER_QUOTA, /* Frames of processes above their rss_limit. */
+    VICTIM_OVER_WSS,   /* Frames of processes above their working set. */
+    VICTIM_ANY,        /* Any frame. */
+};
+
+/* Returns true if T holds as many frames as it is allowed to. */
+static bool vm_at_quota(struct thread *t) {
+    return t->rss_limit != 0 && t->rss >= t->rss_limit;
+}
+
+/* Returns true if FRAME belongs to class CLASS. */
+static bool vm_victim_in_class(struct frame *frame, enum victim_class class) {
+    struct thread *owner = frame->owner;
+
+    switch (class) {
+        case VICTIM_OWN:
+            return owner == thread_current();
+        case VICTIM_OVER_QUOTA:
+            return owner->vm_suspended ||
+                   (owner->rss_limit != 0 && owner->rss > owner->rss_limit);
+        case VICTIM_OVER_WSS:
+            return owner->rss > owner->wss;
+        default:
+            return true;
+    }
+}
+
+/* Run the clock over the frames of CLASS.  The caller holds
+ * frame_table_lock. */
+static struct frame *vm_clock_scan(enum victim_class class) {
+    // 시계 바늘은 한 바퀴 돌며 accessed bit를 지우므로 두 바퀴면 충분하다.
+    size_t limit = frame_cnt * 2;
+
+    for (size_t scanned = 0; scanned < limit; scanned++) {
+        struct frame *frame = &frame_table[clock_hand];
+        clock_hand = (clock_hand + 1) % frame_cnt;
+
+        if (frame->owner == NULL || frame->owner->pml4 == NULL ||
+            frame->busy || frame->pin_cnt > 0 ||
+            !vm_victim_in_class(frame, class)) {
+            continue;
+        }
+        // bit가 1인 경우
+        if (pml4_is_accessed(frame->owner->pml4, frame->page->va)) {
+            pml4_set_accessed(frame->owner->pml4, frame->page->va, 0);
+            continue;
+        }
+        if (vm_lock_owner(frame->owner)) {
+            frame->busy = true;
+            frame->owner->rss--;
+            frame->owner->swap_cnt++;
+            vm_evict_cnt++;
+            return frame;
+        }
+    }
+    return NULL;
+}
+
+/* Get the struct frame, that will be evicted.  The victim is returned
+ * busy with its owner's SPT lock held, or NULL if every frame is in
+ * use right now.  A process at its quota replaces its own pages;
+ * otherwise processes over their quota, then over their working set,
+ * give up frames before anyone else. */
 static struct frame *vm_get_victim(void) {
     struct frame *victim = NULL;
+    enum victim_class class;
     /* TODO: The policy for eviction is up to you. */
+
+    mutex_lock(&frame_table_lock);
+    class = vm_at_quota(thread_current()) ? VICTIM_OWN : VICTIM_OVER_QUOTA;
+    for (; victim == NULL && class <= VICTIM_ANY; class++) {
+        victim = vm_clock_scan(class);
+    }
+    mutex_unlock(&frame_table_lock);
+    return victim;
+}
+
+/* Suspend HOG if the last period evicted vm_thrash_threshold frames
+ * or more and ACTIVE processes are competing for memory; once the rate
+ * falls below half of that, let the oldest suspended process run
+ * again.  Called by the sampler with frame_table_lock held. */
+static void vm_load_control(struct thread *hog, int active) {
+    static unsigned last_evict_cnt;
+    unsigned evictions = vm_evict_cnt - last_evict_cnt;
+
+    last_evict_cnt = vm_evict_cnt;
+    if (vm_thrash_threshold == 0) {
+        return;
+    }
+
+    lock_acquire(&load_lock);
+    if (evictions >= vm_thrash_threshold) {
+        if (hog != NULL && active > 1) {
+            hog->vm_suspended = true;
+            list_push_back(&suspended_list, &hog->suspend_elem);
+            vm_suspend_cnt++;
+        }
+    } else if (evictions < vm_thrash_threshold / 2 &&
+               !list_empty(&suspended_list)) {
+        struct thread *t = list_entry(list_pop_front(&suspended_list),
+                                      struct thread, suspend_elem);
+        t->vm_suspended = false;
+        cond_broadcast(&load_cond, &load_lock);
+    }
+    lock_release(&load_lock);
+}
+
+/* Block the current process while load control holds it back. */
+static void vm_wait_if_suspended(void) {
     struct thread *curr = thread_current();
-    clock_ref = list_begin(&frame_table);
-    
-    lock_acquire(&frame_table_lock);
-    for (clock_ref; clock_ref != list_end(&frame_table);
-         clock_ref = list_next(clock_ref)) {
-        victim = list_entry(clock_ref, struct frame, frame_elem);
-        // bit가 1인 경우
-        if (pml4_is_accessed(curr->pml4, victim->page->va)) {
-            pml4_set_accessed(curr->pml4, victim->page->va, 0);
-        } else {
-            lock_release(&frame_table_lock);
-            return victim;
+
+    if (!curr->vm_suspended) {
+        return;
+    }
+    lock_acquire(&load_lock);
+    while (curr->vm_suspended) {
+        cond_wait(&load_cond, &load_lock);
+    }
+    lock_release(&load_lock);
+}
+
+/* Take T off the suspended list and let it run again. */
+static void vm_resume(struct thread *t) {
+    lock_acquire(&load_lock);
+    if (t->vm_suspended) {
+        list_remove(&t->suspend_elem);
+        t->vm_suspended = false;
+        cond_broadcast(&load_cond, &load_lock);
+    }
+    lock_release(&load_lock);
+}
+
+/* State of an OOM victim search. */
+struct oom_scan {
+    struct thread *victim; /* Best candidate so far. */
+    size_t score;          /* Its badness. */
+};
+
+/* OOM badness of T: its resident plus swapped pages, scaled by its
+ * adjustment, or 0 if T cannot be chosen. */
+static size_t vm_oom_score(struct thread *t) {
+    size_t pages = t->rss + t->swap_pages;
+
+    if (t->pml4 == NULL || t->oom_adj <= OOM_ADJ_MIN) {
+        return 0;
+    }
+    return pages * (t->oom_adj - OOM_ADJ_MIN) / -OOM_ADJ_MIN;
+}
+
+/* thread_foreach() callback for vm_oom_kill().  A victim that has
+ * not finished giving its memory back is always picked again. */
+static void vm_oom_scan(struct thread *t, void *aux) {
+    struct oom_scan *scan = aux;
+    size_t score = vm_oom_score(t);
+
+    if (t->oom_killed && t->rss + t->swap_pages > 0) {
+        score = SIZE_MAX;
+    }
+    if (score > scan->score) {
+        scan->victim = t;
+        scan->score = score;
+    }
+}
+
+/* Take every frame and swap slot of VICTIM back at once.  It never
+ * runs user code again: its next fault or system call ends it.  The
+ * caller holds VICTIM's SPT lock. */
+static void vm_oom_reclaim(struct thread *victim) {
+    struct hash_iterator i;
+
+    hash_first(&i, &victim->spt.hash_table);
+    while (hash_next(&i)) {
+        struct page *page = hash_entry(hash_cur(&i), struct page, hash_elem);
+        if (page->frame == NULL || page->frame->pin_cnt == 0) {
+            vm_drop_page(victim, page);
         }
     }
+}
 
-    struct list_elem *iter = list_begin(&frame_table);
+/* Memory and swap are both exhausted: kill the process with the
+ * largest adjusted footprint instead of wedging the kernel. */
+static void vm_oom_kill(void) {
+    struct oom_scan scan = {NULL, 0};
+    struct thread *victim;
+    enum intr_level old_level;
+    bool locked = false;
 
-    for (iter; iter != list_end(&frame_table); iter = list_next(iter)) {
-        victim = list_entry(iter, struct frame, frame_elem);
-        // bit가 1인 경우
-        if (pml4_is_accessed(curr->pml4, victim->page->va)) {
-            pml4_set_accessed(curr->pml4, victim->page->va, 0);
-        } else {
-            lock_release(&frame_table_lock);
-            return victim;
+    // 고른 뒤 SPT 락을 잡을 때까지 victim이 사라지지 않도록 인터럽트를 끈다.
+    old_level = intr_disable();
+    thread_foreach(vm_oom_scan, &scan);
+    victim = scan.victim;
+    if (victim != NULL) {
+        victim->oom_killed = true;
+        locked = victim != thread_current() && vm_lock_owner(victim);
+    }
+    intr_set_level(old_level);
+
+    if (victim == NULL) {
+        PANIC("out of memory and swap");
+    }
+    if (locked) {
+        vm_resume(victim);
+        vm_oom_reclaim(victim);
+        lock_release(&victim->spt.lock);
+    } else if (victim != thread_current()) {
+        // victim이 커널 안에 있다. 스스로 정리할 때까지 기다린다.
+        thread_yield();
+    }
+}
+
+/* Prints paging statistics. */
+void vm_print_stats(void) {
+    printf("VM: %u page faults, %u evictions, %u suspensions\n",
+           vm_fault_cnt, vm_evict_cnt, vm_suspend_cnt);
+    vm_swap_print_stats();
+    printf("VM: fault latency in TSC cycles:");
+    for (int i = 0; i < VMSTAT_BUCKETS; i++) {
+        if (vm_fault_hist[i] != 0) {
+            printf(" [2^%d] %" PRIu64, i, vm_fault_hist[i]);
         }
     }
-    
-    lock_release(&frame_table_lock);
-    ASSERT(clock_ref != NULL);
-    return victim;
+    printf("\n");
+}
+
+/* Estimate each process's working set: count the frames it touched
+ * since the last sample and fold that into a running average.  The
+ * accessed bits are cleared so that the next sample starts afresh. */
+static void vm_wss_sample(void) {
+    struct thread *hog = NULL;
+    int active = 0;
+    struct frame *frame;
+
+    mutex_lock(&frame_table_lock);
+    for (frame = frame_table; frame < frame_table + frame_cnt; frame++) {
+        if (frame->owner != NULL) {
+            frame->owner->wss_sample = 0;
+        }
+    }
+    for (frame = frame_table; frame < frame_table + frame_cnt; frame++) {
+        if (frame->owner == NULL || frame->owner->pml4 == NULL ||
+            frame->busy || frame->page == NULL) {
+            continue;
+        }
+        frame->age >>= 1;
+        if (pml4_is_accessed(frame->owner->pml4, frame->page->va)) {
+            pml4_set_accessed(frame->owner->pml4, frame->page->va, false);
+            frame->age |= 0x80;
+            frame->owner->wss_sample++;
+        }
+    }
+    // 프레임마다 주인이 겹치므로 반영한 주인은 -1로 표시해 둔다.
+    for (frame = frame_table; frame < frame_table + frame_cnt; frame++) {
+        struct thread *owner = frame->owner;
+        if (owner != NULL && owner->wss_sample >= 0) {
+            owner->wss = (owner->wss + owner->wss_sample + 1) / 2;
+            owner->wss_sample = -1;
+            owner->pf_rate = owner->pf_cnt - owner->pf_last;
+            owner->pf_last = owner->pf_cnt;
+
+            // 가장 낮은 우선순위, 그중 가장 많은 프레임을 쥔 프로세스.
+            if (owner->vm_suspended) {
+                continue;
+            }
+            active++;
+            if (hog == NULL || owner->priority < hog->priority ||
+                (owner->priority == hog->priority && owner->rss > hog->rss)) {
+                hog = owner;
+            }
+        }
+    }
+    vm_load_control(hog, active);
+    mutex_unlock(&frame_table_lock);
+}
+
+/* Background thread that samples working sets every WSS_INTERVAL
+ * ticks. */
+static void vm_wss_sampler(void *aux UNUSED) {
+    for (;;) {
+        timer_sleep(WSS_INTERVAL);
+        vm_wss_sample();
+    }
 }
 
-/* Evict one page and return the corresponding frame.
- * Return NULL on error.*/
+/* Evict one page and return the corresponding frame, still busy, or
+ * NULL if the victim could not be written out because swap is full.
+ * The frame-table lock is not held while the page is written out, so
+ * faults elsewhere keep going during the I/O. */
 static struct frame *vm_evict_frame(void) {
-    struct frame *victim UNUSED = vm_get_victim();
+    struct frame *victim;
+    struct thread *owner;
+
+    while ((victim = vm_get_victim()) == NULL) {
+        thread_yield();
+    }
+    owner = victim->owner;
+
     /* TODO: swap out the victim and return the evicted frame. */
-    //printf("victim is going well  kva = %p\n", victim->kva);
-    swap_out(victim->page);
+    if (swap_out(victim->page)) {
+        victim->page->frame = NULL;
+        victim->page = NULL;
+        thread_current()->faults.evictions++;
+    } else {
+        // 그대로 주인에게 돌려준다.
+        mutex_lock(&frame_table_lock);
+        victim->busy = false;
+        owner->rss++;
+        mutex_unlock(&frame_table_lock);
+        victim = NULL;
+    }
+
+    if (owner != thread_current()) {
+        lock_release(&owner->spt.lock);
+    }
     return victim;
 }
 
 /* palloc() and get frame. If there is no available page, evict the page
- * and return it. This always return valid address. That is, if the user pool
- * memory is full, this function evicts the frame to get the available memory
- * space.*/
+ * and return it.  If neither memory nor swap is left, the OOM killer
+ * picks a process to die; NULL is returned only if that process is the
+ * caller.*/
 static struct frame *vm_get_frame(void) {
+    struct thread *curr = thread_current();
     struct frame *frame = NULL;
-    frame = (struct frame *)malloc(sizeof(struct frame));
-
-    /* TODO: Fill this function. */
-    frame->page = NULL;
-    frame->kva = palloc_get_page(PAL_USER);
+    // 할당량을 다 쓴 프로세스는 빈 프레임이 있어도 자기 페이지를 내보낸다.
+    bool local = vm_at_quota(curr);
+    int failed = 0;
+    void *kva;
 
-    if (frame->kva == NULL) {
+    for (;;) {
+        kva = local ? NULL : palloc_get_page(PAL_USER);
+        if (kva != NULL) {
+            break;
+        }
         frame = vm_evict_frame();
-        frame->page = NULL;
-        return frame;
+        if (frame != NULL) {
+            return frame;
+        }
+        if (local) {
+            local = false;
+            continue;
+        }
+        // swap이 가득 차도 파일 페이지라면 내보낼 수 있으니 몇 번 더 돈다.
+        if (++failed < OOM_EVICT_TRIES) {
+            continue;
+        }
+        failed = 0;
+        vm_oom_kill();
+        if (curr->oom_killed) {
+            return NULL;
+        }
     }
-    ASSERT(frame != NULL);
-    ASSERT(frame->page == NULL);
 
-    lock_acquire(&frame_table_lock);
-    list_push_back(&frame_table, &frame->frame_elem);
-    lock_release(&frame_table_lock);
+    /* TODO: Fill this function. */
+    frame = vm_kva_to_frame(kva);
+    ASSERT(frame->owner == NULL);
+    ASSERT(frame->page == NULL);
 
-    //printf("frame_list size is %d\n", list_size(&frame_table));
+    mutex_lock(&frame_table_lock);
+    frame->owner = curr;
+    frame->busy = true;
+    frame->pin_cnt = 0;
+    frame->age = 0;
+    mutex_unlock(&frame_table_lock);
     return frame;
 }
 
-/* Growing the stack. */
-#define ONE_MB (1 << 20)
+/* Return FRAME to the user pool.  The caller must already have
+ * unmapped it from its owner's page table. */
+void vm_free_frame(struct frame *frame) {
+    mutex_lock(&frame_table_lock);
+    frame->owner->rss--;
+    frame->owner = NULL;
+    frame->page = NULL;
+    frame->busy = false;
+    mutex_unlock(&frame_table_lock);
+
+    palloc_free_page(frame->kva);
+}
+
+/* Mark FRAME busy so that the evictor leaves it alone while it is
+ * being read from.  Returns false if it is busy already. */
+bool vm_try_busy_frame(struct frame *frame) {
+    bool success;
+
+    mutex_lock(&frame_table_lock);
+    success = !frame->busy;
+    frame->busy = true;
+    mutex_unlock(&frame_table_lock);
+    return success;
+}
+
+/* Undo vm_try_busy_frame(FRAME). */
+void vm_unbusy_frame(struct frame *frame) {
+    mutex_lock(&frame_table_lock);
+    frame->busy = false;
+    mutex_unlock(&frame_table_lock);
+}
+
+/* Extra stack pages to map below a stack fault (-stack-pregrow). */
+unsigned vm_stack_pregrow = 0;
+
+/* Returns true if a missing page at ADDR should be treated as stack
+ * growth, given the user stack pointer RSP. */
+static bool vm_is_stack_access(void *addr, uintptr_t rsp) {
+    return addr < thread_current()->stack_bottom &&
+           addr >= (void *)STACK_LIMIT && (uintptr_t)addr >= rsp - 8;
+}
+
+/* Growing the stack.
+ * Maps every page between the current stack bottom and ADDR, plus
+ * vm_stack_pregrow pages below ADDR, and claims them right away, so
+ * that a large frame or a deep call chain takes one fault instead of
+ * one per page.  The caller holds the SPT lock. */
 static void vm_stack_growth(void *addr UNUSED) {
-    uintptr_t stack_bottom = pg_round_down(addr);
-    vm_alloc_page(VM_ANON | VM_MARKER_0, stack_bottom, true);
+    struct thread *curr = thread_current();
+    void *old_bottom = curr->stack_bottom;
+    void *new_bottom = pg_round_down(addr);
+    void *va;
+
+    if ((uintptr_t)new_bottom - STACK_LIMIT > vm_stack_pregrow * PGSIZE) {
+        new_bottom -= vm_stack_pregrow * PGSIZE;
+    } else {
+        new_bottom = (void *)STACK_LIMIT;
+    }
+
+    // 지금의 스택 바닥에서 아래로 한 페이지씩 붙여서, 중간에 실패해도 스택이 끊기지 않게 한다.
+    for (va = old_bottom - PGSIZE; va >= new_bottom; va -= PGSIZE) {
+        if (spt_find_page(&curr->spt, va) != NULL ||
+            !vm_alloc_page(VM_ANON | VM_MARKER_0, va, true)) {
+            break;
+        }
+        curr->stack_bottom = va;
+    }
+    for (va = curr->stack_bottom; va < old_bottom; va += PGSIZE) {
+        struct page *page = spt_find_page(&curr->spt, va);
+        if (page->frame == NULL && !vm_do_claim_page(page)) {
+            break;
+        }
+    }
 }
 
 /* Handle the fault on write_protected page */
@@ -223,27 +659,301 @@ bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED,
     }
 
     /* TODO: Your code goes here */
-    uintptr_t stack_limit = USER_STACK - (1 << 20);
+    thread_current()->pf_cnt++;
+    vm_fault_cnt++;
+    // 사용자 모드 fault에서만 멈춘다. 커널은 락을 쥐고 있을 수 있다.
+    if (user) {
+        vm_wait_if_suspended();
+    }
+    // OOM killer에게 선택되었다면 돌아가지 않고 종료한다.
+    if (thread_current()->oom_killed) {
+        return false;
+    }
+
+    uint64_t start = rdtsc();
     uintptr_t rsp = user ? f->rsp : thread_current()->user_rsp;
-    if (addr >= rsp - 8 && addr <= USER_STACK && addr >= stack_limit) {
+    unsigned *counter = &thread_current()->faults.minor;
+    bool success = false;
+    lock_acquire(&spt->lock);
+    page = spt_find_page(spt, addr);
+    if (page == NULL && vm_is_stack_access(addr, rsp)) {
         vm_stack_growth(addr);
+        page = spt_find_page(spt, addr);
+        counter = &thread_current()->faults.stack;
+    }
+    // 다른 스레드가 먼저 올려놓았을 수도 있다.
+    if (page != NULL && (!write || page->writable)) {
+        if (page->frame == NULL) {
+            counter = vm_fault_counter(thread_current(), page);
+        }
+        success = page->frame != NULL || vm_do_claim_page(page);
+    }
+    if (success && page->advice == MADV_SEQUENTIAL) {
+        vm_sequential_fault(spt, page);
     }
+    lock_release(&spt->lock);
 
-    if ((page = spt_find_page(spt, addr)) == NULL) {
-        return false;
+    if (success) {
+        (*counter)++;
+        vm_record_latency(rdtsc() - start);
+    }
+    return success;
+}
+
+/* Returns the counter of CURR that a fault bringing in PAGE counts
+ * against: whether it has to read from swap, from a file, or
+ * nothing at all. */
+static unsigned *vm_fault_counter(struct thread *curr, struct page *page) {
+    switch (VM_TYPE(page->operations->type)) {
+        case VM_UNINIT: {
+            // 실행 파일 세그먼트와 mmap은 initializer가 파일을 읽는다.
+            struct lazy_load_info *info = page->uninit.aux;
+            return page->uninit.init != NULL && info->read_bytes > 0
+                       ? &curr->faults.major_file
+                       : &curr->faults.minor;
+        }
+        case VM_ANON:
+            return page->anon.swap_sector != -1 ? &curr->faults.major_swap
+                                                : &curr->faults.minor;
+        default:
+            return &curr->faults.major_file;
+    }
+}
+
+/* Add a fault that took CYCLES to the latency histogram. */
+static void vm_record_latency(uint64_t cycles) {
+    int bucket = 0;
+
+    while (cycles >>= 1) {
+        bucket++;
     }
+    if (bucket >= VMSTAT_BUCKETS) {
+        bucket = VMSTAT_BUCKETS - 1;
+    }
+    vm_fault_hist[bucket]++;
+}
 
-    if (write && !(page->writable)) {
+/* Copy the current process's fault counters and the system-wide
+ * latency histogram to user buffer ST.  Returns false if ST is not
+ * writable user memory. */
+bool vm_get_stats(struct vmstat *st) {
+    struct vmstat buf;
+
+    buf.proc = thread_current()->faults;
+    memcpy(buf.latency, vm_fault_hist, sizeof buf.latency);
+    if (!vm_pin_range(st, sizeof *st, true)) {
         return false;
     }
+    memcpy(st, &buf, sizeof *st);
+    vm_unpin_range(st, sizeof *st);
+    return true;
+}
+
+/* Fault in the MADV_SEQUENTIAL pages following PAGE, and clear the
+ * accessed bits of the pages behind it so the clock takes them first. */
+static void vm_sequential_fault(struct supplemental_page_table *spt,
+                                struct page *page) {
+    struct thread *curr = thread_current();
+
+    for (int i = 1; i <= VM_READAHEAD_PAGES; i++) {
+        struct page *next = spt_find_page(spt, page->va + i * PGSIZE);
+        if (next == NULL || next->advice != MADV_SEQUENTIAL) {
+            break;
+        }
+        if (next->frame == NULL && !vm_do_claim_page(next)) {
+            break;
+        }
+    }
+
+    for (int i = 1; i <= VM_READAHEAD_PAGES + 1; i++) {
+        if (page->va < (void *)((uintptr_t)i * PGSIZE)) {
+            break;
+        }
+        struct page *prev = spt_find_page(spt, page->va - i * PGSIZE);
+        if (prev == NULL || prev->advice != MADV_SEQUENTIAL) {
+            break;
+        }
+        if (prev->frame != NULL) {
+            pml4_set_accessed(curr->pml4, prev->va, false);
+        }
+    }
+}
+
+/* Release the frame behind OWNER's PAGE so that the next access
+ * faults.  Dirty file-backed contents are written back first;
+ * anonymous contents (and their swap slot) are thrown away. */
+static void vm_drop_page(struct thread *owner, struct page *page) {
+    struct frame *frame = page->frame;
+    enum vm_type type = VM_TYPE(page->operations->type);
+
+    if (frame != NULL) {
+        if (type == VM_FILE) {
+            swap_out(page);
+        } else {
+            pml4_clear_page(owner->pml4, page->va);
+        }
+        page->frame = NULL;
+        vm_free_frame(frame);
+    }
+
+    if (type == VM_ANON) {
+        anon_discard(page, owner);
+    }
+}
+
+/* Apply ADVICE to every page in [ADDR, ADDR + LENGTH).
+ * Returns 0 on success, -1 if part of the range is not mapped. */
+int vm_madvise(void *addr, size_t length, enum vm_advice advice) {
+    struct supplemental_page_table *spt = &thread_current()->spt;
+    int result = 0;
+
+    lock_acquire(&spt->lock);
+    for (void *va = addr; va < addr + length; va += PGSIZE) {
+        struct page *page = spt_find_page(spt, va);
+        if (page == NULL) {
+            result = -1;
+            continue;
+        }
+
+        switch (advice) {
+            case MADV_NORMAL:
+            case MADV_RANDOM:
+            case MADV_SEQUENTIAL:
+                page->advice = advice;
+                break;
+            case MADV_WILLNEED:
+                if (page->frame == NULL) {
+                    vm_do_claim_page(page);
+                }
+                break;
+            case MADV_DONTNEED:
+                vm_drop_page(thread_current(), page);
+                break;
+        }
+    }
+    lock_release(&spt->lock);
+    return result;
+}
 
-    if (!vm_do_claim_page(page)) {
+/* Load every page of [ADDR, ADDR + LENGTH) now instead of on first
+ * touch.  Pages are claimed in address order, so a file-backed range
+ * is read front to back in a single pass.  Holes in the range are
+ * skipped.  Returns false if a page could not be loaded. */
+bool vm_populate(void *addr, size_t length) {
+    struct supplemental_page_table *spt = &thread_current()->spt;
+    bool success = true;
+
+    lock_acquire(&spt->lock);
+    for (void *va = pg_round_down(addr); va < addr + length; va += PGSIZE) {
+        struct page *page = spt_find_page(spt, va);
+        if (page != NULL && page->frame == NULL && !vm_do_claim_page(page)) {
+            success = false;
+            break;
+        }
+    }
+    lock_release(&spt->lock);
+    return success;
+}
+
+/* Fault in every page of the user range [ADDR, ADDR + LENGTH) and pin
+ * its frames, so that a system call can do I/O straight into a user
+ * buffer without faulting halfway through.  The evictor leaves pinned
+ * frames alone until vm_unpin_range().  Returns false, with nothing
+ * left pinned, if part of the range is unmapped or, when WRITE is
+ * true, read-only. */
+bool vm_pin_range(const void *addr, size_t length, bool write) {
+    struct thread *curr = thread_current();
+    struct supplemental_page_table *spt = &curr->spt;
+    void *start = pg_round_down(addr);
+    void *va;
+
+    lock_acquire(&spt->lock);
+    for (va = start; va < addr + length; va += PGSIZE) {
+        struct page *page = spt_find_page(spt, va);
+        // 스택에 있는 버퍼는 아직 자라지 않은 페이지일 수 있다.
+        if (page == NULL &&
+            vm_is_stack_access(va + PGSIZE - 1, curr->user_rsp)) {
+            vm_stack_growth(va);
+            page = spt_find_page(spt, va);
+        }
+        if (page == NULL || (write && !page->writable) ||
+            (page->frame == NULL && !vm_do_claim_page(page))) {
+            break;
+        }
+        page->frame->pin_cnt++;
+    }
+    lock_release(&spt->lock);
+
+    if (va < addr + length) {
+        vm_unpin_range(start, va - start);
         return false;
     }
-    
     return true;
 }
 
+/* Release the pins taken by vm_pin_range(ADDR, LENGTH). */
+void vm_unpin_range(const void *addr, size_t length) {
+    struct supplemental_page_table *spt = &thread_current()->spt;
+
+    lock_acquire(&spt->lock);
+    for (void *va = pg_round_down(addr); va < addr + length; va += PGSIZE) {
+        struct page *page = spt_find_page(spt, va);
+        if (page != NULL && page->frame != NULL && page->frame->pin_cnt > 0) {
+            page->frame->pin_cnt--;
+        }
+    }
+    lock_release(&spt->lock);
+}
+
+/* Move the current process's break by INCREMENT bytes and return the
+ * old break, or (void *) -1 on failure.  New heap pages are anonymous
+ * and faulted in lazily; pages wholly above a lowered break are
+ * freed. */
+void *vm_sbrk(intptr_t increment) {
+    struct thread *curr = thread_current();
+    struct supplemental_page_table *spt = &curr->spt;
+    void *old_brk = curr->heap_brk;
+    void *new_brk = old_brk + increment;
+    void *old_top = pg_round_up(old_brk);
+    void *new_top = pg_round_up(new_brk);
+    void *va;
+
+    if (curr->heap_start == NULL ||
+        (increment >= 0 ? new_brk < old_brk : new_brk > old_brk) ||
+        new_brk < curr->heap_start ||
+        new_top > (void *)STACK_GUARD) {
+        return (void *)-1;
+    }
+
+    lock_acquire(&spt->lock);
+    for (va = old_top; va < new_top; va += PGSIZE) {
+        if (spt_find_page(spt, va) != NULL) {
+            lock_release(&spt->lock);
+            return (void *)-1;
+        }
+    }
+    for (va = old_top; va < new_top; va += PGSIZE) {
+        if (!vm_alloc_page(VM_ANON, va, true)) {
+            // 이번에 붙인 페이지를 되돌리고 break는 그대로 둔다.
+            while (va > old_top) {
+                va -= PGSIZE;
+                spt_remove_page(spt, spt_find_page(spt, va));
+            }
+            lock_release(&spt->lock);
+            return (void *)-1;
+        }
+    }
+    for (va = new_top; va < old_top; va += PGSIZE) {
+        struct page *page = spt_find_page(spt, va);
+        if (page != NULL) {
+            spt_remove_page(spt, page);
+        }
+    }
+    curr->heap_brk = new_brk;
+    lock_release(&spt->lock);
+    return old_brk;
+}
+
 /* Free the page.
  * DO NOT MODIFY THIS FUNCTION. */
 void vm_dealloc_page(struct page *page) {
@@ -253,36 +963,65 @@ void vm_dealloc_page(struct page *page) {
 
 /* Claim the page that allocate on VA. */
 bool vm_claim_page(void *va UNUSED) {
+    struct supplemental_page_table *spt = &thread_current()->spt;
     struct page *page = NULL;
+    bool success = false;
     /* TODO: Fill this function */
-    page = spt_find_page(&thread_current()->spt, va);
-    if (page == NULL) {
-        return false;
+    lock_acquire(&spt->lock);
+    page = spt_find_page(spt, va);
+    if (page != NULL) {
+        success = vm_do_claim_page(page);
     }
-
-    return vm_do_claim_page(page);
+    lock_release(&spt->lock);
+    return success;
 }
 
-/* Claim the PAGE and set up the mmu. */
-static bool vm_do_claim_page(struct page *page) {
+/* Claim the PAGE for OWNER and set up the mmu.  The caller must hold
+ * OWNER's SPT lock. */
+static bool vm_do_claim_page_for(struct thread *owner, struct page *page) {
     struct frame *frame = vm_get_frame();
+    bool success = false;
+
+    if (frame == NULL) {
+        return false;
+    }
 
     /* Set links */
+    mutex_lock(&frame_table_lock);
+    frame->owner = owner;
+    owner->rss++;
     frame->page = page;   // 여기서  frame에 page를 할당.
     page->frame = frame;  // 서로가 서로를 할당하는 모습
+    mutex_unlock(&frame_table_lock);
+
+    // 한 번 올라왔던 페이지를 다시 읽어 오는 것은 swap I/O로 센다.
+    if (VM_TYPE(page->operations->type) != VM_UNINIT) {
+        owner->swap_cnt++;
+    }
 
-    bool set_page = false;
     /* TODO: Insert page table entry to map page's VA to frame's PA. */
-    if (!pml4_get_page(thread_current()->pml4,
-                       page->va)) {  // NULL이어야 기존것이 아님.
-        set_page = pml4_set_page(thread_current()->pml4, page->va, frame->kva,
-                                 page->writable);
-        if (set_page) {
-            return swap_in(page, frame->kva);
-        }
+    if (!pml4_get_page(owner->pml4, page->va)) {  // NULL이어야 기존것이 아님.
+        // 내용을 다 채운 뒤에 매핑해야 주인이 반쯤 찬 페이지를 보지 않는다.
+        success = swap_in(page, frame->kva) &&
+                  pml4_set_page(owner->pml4, page->va, frame->kva,
+                                page->writable);
     }
 
-    return false;
+    if (!success) {
+        // 매핑되지 않은 프레임이 연결된 채 남으면 clock이 그것을 쫓아낸다.
+        page->frame = NULL;
+        vm_free_frame(frame);
+        return false;
+    }
+    mutex_lock(&frame_table_lock);
+    frame->busy = false;
+    mutex_unlock(&frame_table_lock);
+    return true;
+}
+
+/* Claim the PAGE and set up the mmu. */
+static bool vm_do_claim_page(struct page *page) {
+    return vm_do_claim_page_for(thread_current(), page);
 }
 
 /* Returns true if page a precedes page b. */
@@ -301,17 +1040,25 @@ uint64_t page_hash(const struct hash_elem *h, void *aux UNUSED) {
 /* Initialize new supplemental page table */
 void supplemental_page_table_init(struct supplemental_page_table *spt UNUSED) {
     hash_init(&spt->hash_table, page_hash, page_less, NULL);
+    lock_init(&spt->lock);
 }
 
 bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED,
                                   struct supplemental_page_table *src UNUSED) {
+    /* SRC is embedded in the parent's struct thread, which starts its
+     * page.  Holding its lock keeps the parent's pages in memory while
+     * they are copied. */
+    struct thread *parent = pg_round_down(src);
+    bool success = false;
     struct hash_iterator i;
+
+    lock_acquire(&src->lock);
     hash_first(&i, &src->hash_table);
     while (hash_next(&i)) {
         struct page *src_page =
             hash_entry(hash_cur(&i), struct page, hash_elem);
         /*vm_alloc_page_with_initializer에 필요한 인자들*/
-        enum vm_type dst_type = page_get_type(src_page);     // 잠재타입
+        enum vm_type dst_type = src_page->uninit.type;  // 잠재타입 (marker 포함)
         enum vm_type now_type = src_page->operations->type;  // 현재타입
         void *dst_va = src_page->va;
         bool dst_writable = src_page->writable;
@@ -325,18 +1072,31 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED,
             void *dst_aux = src_page->uninit.aux;
             if (!vm_alloc_page_with_initializer(dst_type, dst_va, dst_writable,
                                                 dst_init, dst_aux)) {
-                return false;
+                goto done;
             }
         }
         /*ANON, FILE 처리*/
         else {
             // 여기서는 now_type과 dst_type은 똑같겠지.
-            if (!vm_alloc_page(now_type, dst_va, dst_writable)) {
-                return false;
+            // file 페이지는 부모의 매핑 정보를 그대로 물려받는다.
+            void *dst_aux = now_type == VM_FILE ? src_page->file.info : NULL;
+            // 익명 mmap 페이지는 매핑 시작 주소를 물려받는다.
+            if (now_type == VM_ANON && src_page->anon.map_start != NULL) {
+                now_type |= VM_ANON_MAP;
+                dst_aux = src_page->anon.map_start;
+            }
+            // 부모 페이지가 쫓겨나 있었다면 먼저 다시 올린다.
+            if (src_page->frame == NULL &&
+                !vm_do_claim_page_for(parent, src_page)) {
+                goto done;
+            }
+            if (!vm_alloc_page_with_initializer(now_type, dst_va, dst_writable,
+                                                NULL, dst_aux)) {
+                goto done;
             }
             /*가짜 frame 할당받기*/
             if (!vm_claim_page(dst_va)) {
-                return false;
+                goto done;
             }
             dst_page = spt_find_page(dst, dst_va);
 
@@ -344,8 +1104,11 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED,
             /*memcpy PGSIZE인 이유는 kva가 palloc_get_page로부터 왔기 때문.*/
         }
     }
+    success = true;
 
-    return true;
+done:
+    lock_release(&src->lock);
+    return success;
 }
 
 void page_free(struct hash_elem *e, void *aux) {
@@ -358,9 +1121,55 @@ void spt_destroy_func(struct hash_elem *e, void *aux) {
     vm_dealloc_page(pg);
 }
 
-/* Free the resource hold by the supplemental page table */
+/* pml4_destroy_with() callback: give back the frame at KVA, which the
+ * exiting process OWNER maps.  frame_table_lock is held only to unlink
+ * the frame, not while it is freed. */
+static void vm_release_frame(void *kva, void *owner) {
+    struct frame *frame = vm_kva_to_frame(kva);
+
+    mutex_lock(&frame_table_lock);
+    if (frame->owner != owner) {
+        mutex_unlock(&frame_table_lock);
+        return;
+    }
+    if (frame->page != NULL) {
+        frame->page->frame = NULL;
+    }
+    frame->owner->rss--;
+    frame->owner = NULL;
+    frame->page = NULL;
+    frame->busy = false;
+    mutex_unlock(&frame_table_lock);
+
+    palloc_free_page(kva);
+}
+
+/* Free the resource hold by the supplemental page table.
+ * The caller has written dirty file pages back already; they leave
+ * the write-back list first, so that the flusher cannot read a frame
+ * that is being freed.  Then every swap slot goes back in one pass,
+ * and every frame goes back in the same walk that frees the page
+ * tables.  That leaves hash_destroy() with nothing to do per page but
+ * free it.  The page directory is gone afterwards: the current thread
+ * runs on base_pml4. */
 void supplemental_page_table_kill(struct supplemental_page_table *spt UNUSED) {
-    // /* TODO: Destroy all the supplemental_page_table hold by thread and
+    struct thread *curr = thread_current();
+    uint64_t *pml4 = curr->pml4;
+
+    lock_acquire(&spt->lock);
+    vm_file_detach(curr);
+    anon_release_swap(spt, curr);
+    if (pml4 != NULL) {
+        // 다른 스레드는 이 락 아래에서만 프레임 주인의 pml4를 보고, NULL이면
+        // 건너뛴다.  그러니 락은 pml4를 떼어 낼 때만 잡으면 된다.
+        mutex_lock(&frame_table_lock);
+        curr->pml4 = NULL;
+        mutex_unlock(&frame_table_lock);
+        pml4_activate(NULL);
+        pml4_destroy_with(pml4, vm_release_frame, curr);
+    }
     hash_destroy(&spt->hash_table, spt_destroy_func);
-    //  * TODO: writeback all the modified contents to the storage. */
+    lock_release(&spt->lock);
+    // 프레임이 없으니 sampler가 다시 고를 수 없다.
+    vm_resume(curr);
 }
\ No newline at end of file